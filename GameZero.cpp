@@ -1,7 +1,33 @@
 #include <iostream>
 #include <vector>
 #include <map>
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdarg>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <ctime>
+#include <functional>
+#include <new>
+#include <type_traits>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#else
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_timer.h>
 #include <SDL2/SDL_image.h>
@@ -79,848 +105,5251 @@ struct Grid
     }
 };
 
-// -----------------------------------------------------------------------------
-
-// -----------------------------------------------------------------------------
-// ENGINE TOOLS
-class SDL_General
+// Small, fast random number generator (xorshift64*). Each game owns one so
+// runs can be saved, restored and replayed exactly.
+struct Random
 {
-public:
-    const int width = 960; 
-    const int height = 720;
-    const Vector2Int pos = Vector2Int();
-    SDL_Window* window;
-    SDL_Renderer* rend;
-    vector<SDL_Event> events;
+    Uint64 state;
 
-    SDL_General():
-        window(NULL),
-        rend(NULL)
+    Random(Uint64 seed = 0x9E3779B97F4A7C15ull):
+        state(seed != 0 ? seed : 1)
     {}
 
-    void Init()
-    {   
-        // Init the SDL/Error catch
-        if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) != 0) 
-        { 
-            std::cerr << "Error with Init: " << SDL_GetError() << std::endl; 
-        }
-
-        if(TTF_Init() < 0) 
-        {
-            std::cerr << "Couldn't initialize TTF lib: " << TTF_GetError() << std::endl;
-        }
-
-        std::cout << "Init successful!!!" 
-                  << std::endl;
+    Uint32 Next()
+    {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return (Uint32) ((state * 0x2545F4914F6CDD1Dull) >> 32);
     }
 
-    void CreateWindow(
-        const char* title, 
-        const Uint32& flags) 
+    // Random int in [0, range)
+    int Range(int range)
     {
-        // Create the SDL window
-        window = SDL_CreateWindow(
-            title,
-            pos.x,
-            pos.y,
-            width,
-            height,
-            flags);
-
-        // Window Error Catch
-        if (window == NULL) 
-        {
-            SDL_Quit();
-            std::cerr << "Error Creating Window: " 
-                      << SDL_GetError() 
-                      << std::endl;
-        }
+        return (int) (Next() % (Uint32) range);
     }
+};
 
-    void CreateRenderer(
-        const Uint32& renderFlags)
+// Sweep a w x h box from one position to another against a still rect.
+// Returns true if they touch along the way, with timeOfImpact set to the
+// fraction of the move (0 to 1) where they first overlap.
+bool SweptAABB(
+    const Vector2& from,
+    const Vector2& to,
+    int w,
+    int h,
+    const SDL_Rect& target,
+    float& timeOfImpact)
+{
+    // Grow the target by the box's size and trace the box's corner as a ray
+    const float minB[2] = {(float) (target.x - w), (float) (target.y - h)};
+    const float maxB[2] = {(float) (target.x + target.w), (float) (target.y + target.h)};
+    const float start[2] = {from.x, from.y};
+    const float move[2] = {to.x - from.x, to.y - from.y};
+
+    float enter = -INFINITY;
+    float exit = INFINITY;
+    for (int axis = 0; axis < 2; axis++) 
     {
-        // Error Catch
-        if (window == NULL) 
+        if (move[axis] == 0) 
         {
-            SDL_Quit();
-            std::cerr << "No Window defined to attach the renderer too"
-                      << std::endl;
+            // Not moving on this axis, it has to overlap already
+            if (start[axis] <= minB[axis] || start[axis] >= maxB[axis]) return false;
+            continue;
         }
 
-        // Create the Render Pointer
-        rend = SDL_CreateRenderer(window, -1, renderFlags);
+        float t0 = (minB[axis] - start[axis]) / move[axis];
+        float t1 = (maxB[axis] - start[axis]) / move[axis];
+        if (t0 > t1) std::swap(t0, t1);
 
-        // Render Error Catch
-        if (!rend) 
-        {
-            SDL_DestroyWindow(window);
-            SDL_Quit();
-            std::cerr << "Error Creating the renderer: " 
-                      << SDL_GetError() 
-                      << std::endl;
-        }
+        enter = std::max(enter, t0);
+        exit = std::min(exit, t1);
+    }
 
-        // Clear the Window by setting it black
-        SDL_RenderClear(rend);
+    if (enter >= exit || enter > 1 || exit <= 0) return false;
+
+    timeOfImpact = std::max(enter, 0.0f);
+    return true;
+}
+
+// One bit per pixel marking which pixels of a sprite are solid. Rows are packed
+// into 64 bit words, leftmost pixel in the top bit, with a spare zero word on
+// the end of each row so a shifted read never runs past it.
+struct CollisionMask
+{
+    int w;
+    int h;
+    int wordsPerRow;
+    std::vector<Uint64> rows;
+
+    CollisionMask():
+        w(0),
+        h(0),
+        wordsPerRow(0)
+    {}
+
+    void Resize(int inW, int inH)
+    {
+        w = inW;
+        h = inH;
+        wordsPerRow = (w + 63) / 64 + 1;
+        rows.assign(wordsPerRow * h, 0);
     }
 
-    SDL_Texture* CreateTextTexture(
-        TTF_Font* font,
-        const char* text,
-        SDL_Color color)
+    void Set(int x, int y)
     {
-        if (window == NULL) 
+        rows[y * wordsPerRow + x / 64] |= (Uint64) 1 << (63 - x % 64);
+    }
+
+    bool Empty() const { return rows.empty(); }
+
+    // Do any solid pixels touch when the other mask sits at (dx, dy) from this one
+    bool Overlaps(const CollisionMask& other, int dx, int dy) const
+    {
+        // The overlapping region in this mask's pixels
+        int x0 = std::max(0, dx);
+        int y0 = std::max(0, dy);
+        int x1 = std::min(w, dx + other.w);
+        int y1 = std::min(h, dy + other.h);
+        if (x0 >= x1 || y0 >= y1) return false;
+
+        int width = x1 - x0;
+        int otherX = x0 - dx;
+        int row = y0;
+
+#ifdef __SSE2__
+        // Sprites are narrow, so do two rows at a time when the overlap fits in a word
+        if (width <= 64) 
         {
-            SDL_Quit();
-            std::cerr << "No Window Defined"
-                      << std::endl;
+            const __m128i zero = _mm_setzero_si128();
+            const Uint64 keep = width == 64 ? ~(Uint64) 0 : ~(~(Uint64) 0 >> width);
+            const __m128i keepBits = _mm_set1_epi64x((long long) keep);
+
+            const int word = x0 >> 6;
+            const int otherWord = otherX >> 6;
+            const __m128i shift = _mm_cvtsi32_si128(x0 & 63);
+            const __m128i backShift = _mm_cvtsi32_si128(64 - (x0 & 63));
+            const __m128i otherShift = _mm_cvtsi32_si128(otherX & 63);
+            const __m128i otherBackShift = _mm_cvtsi32_si128(64 - (otherX & 63));
+
+            for (; row + 2 <= y1; row += 2) 
+            {
+                const Uint64* a0 = &rows[row * wordsPerRow + word];
+                const Uint64* a1 = a0 + wordsPerRow;
+                const Uint64* b0 = &other.rows[(row - dy) * other.wordsPerRow + otherWord];
+                const Uint64* b1 = b0 + other.wordsPerRow;
+
+                // A shift by 64 clears the lane, so aligned reads need no special case
+                __m128i a = _mm_or_si128(
+                    _mm_sll_epi64(_mm_set_epi64x((long long) a1[0], (long long) a0[0]), shift),
+                    _mm_srl_epi64(_mm_set_epi64x((long long) a1[1], (long long) a0[1]), backShift));
+                __m128i b = _mm_or_si128(
+                    _mm_sll_epi64(_mm_set_epi64x((long long) b1[0], (long long) b0[0]), otherShift),
+                    _mm_srl_epi64(_mm_set_epi64x((long long) b1[1], (long long) b0[1]), otherBackShift));
+
+                __m128i hit = _mm_and_si128(_mm_and_si128(a, b), keepBits);
+                if (_mm_movemask_epi8(_mm_cmpeq_epi8(hit, zero)) != 0xFFFF) return true;
+            }
         }
+#endif
 
-        if (rend == NULL) 
+        for (; row < y1; row++) 
         {
-            SDL_DestroyWindow(window);
-            SDL_Quit();
-            std::cerr << "No Renderer Defined"
-                      << std::endl;
-        }
+            const Uint64* a = &rows[row * wordsPerRow];
+            const Uint64* b = &other.rows[(row - dy) * other.wordsPerRow];
 
-        // Create the surface
-        SDL_Surface* surfaceMessage = TTF_RenderText_Solid(
-            font, 
-            text, 
-            color); 
+            for (int offset = 0; offset < width; offset += 64) 
+            {
+                Uint64 bits = ReadBits(a, x0 + offset) & ReadBits(b, otherX + offset);
 
-        // now you can convert it into a texture
-        SDL_Texture* textureMessage = SDL_CreateTextureFromSurface(
-            rend, 
-            surfaceMessage);
+                // Ignore the pixels past the end of the overlap
+                int remaining = width - offset;
+                if (remaining < 64) bits &= ~(~(Uint64) 0 >> remaining);
 
-        // Disposing of the surface now that it's in grahpic memory
-        SDL_FreeSurface(surfaceMessage);  
+                if (bits != 0) return true;
+            }
+        }
 
-        // Return message texture
-        return textureMessage;
+        return false;
     }
 
-    SDL_Texture* LoadTexture(
-        const char* filePath)
+    private:
+    // 64 pixels starting at the given one, leftmost in the top bit
+    static Uint64 ReadBits(const Uint64* row, int pixel)
     {
-        if (window == NULL) 
-        {
-            SDL_Quit();
-            std::cerr << "No Window Defined"
-                      << std::endl;
-        }
+        int word = pixel >> 6;
+        int shift = pixel & 63;
 
-        if (rend == NULL) 
-        {
-            SDL_DestroyWindow(window);
-            SDL_Quit();
-            std::cerr << "No Renderer Defined"
-                      << std::endl;
-        }
+        Uint64 bits = row[word] << shift;
+        if (shift != 0) bits |= row[word + 1] >> (64 - shift);
+        return bits;
+    }
+};
+
+// A Catmull-Rom curve through the given points, flattened into a table of
+// points spaced evenly along its length. Following it at a steady speed is
+// then just a lookup and a lerp, whatever the shape of the curve.
+struct SplinePath
+{
+    float step;
+    float length;
+    std::vector<Vector2> table;
 
-        // Load the image into main memory using the SDL library
-        SDL_Surface* surf = IMG_Load(filePath);
+    SplinePath():
+        step(1),
+        length(0)
+    {}
 
-        // If the texture file path wasn't found
-        if (!surf) 
+    void Build(const std::vector<Vector2>& points, float inStep = 1.0f)
+    {
+        step = inStep;
+        table.clear();
+        if (points.size() < 2) return;
+
+        // Sample the curve finely, keeping the distance travelled to each sample
+        const int samplesPerSegment = 32;
+        std::vector<Vector2> samples;
+        std::vector<float> distances;
+        samples.push_back(points[0]);
+        distances.push_back(0);
+
+        int last = (int) points.size() - 1;
+        for (int seg = 0; seg < last; seg++) 
         {
-            SDL_DestroyRenderer(rend);
-            SDL_DestroyWindow(window);
-            SDL_Quit();
-            std::cerr << "Error Loading the image: " 
-                      << SDL_GetError() 
-                      << std::endl;
+            // The end points are repeated to close off the curve
+            const Vector2& p0 = points[std::max(seg - 1, 0)];
+            const Vector2& p1 = points[seg];
+            const Vector2& p2 = points[seg + 1];
+            const Vector2& p3 = points[std::min(seg + 2, last)];
+
+            for (int i = 1; i <= samplesPerSegment; i++) 
+            {
+                float t = (float) i / samplesPerSegment;
+                Vector2 point(CatmullRom(p0.x, p1.x, p2.x, p3.x, t), CatmullRom(p0.y, p1.y, p2.y, p3.y, t));
+
+                const Vector2& prev = samples.back();
+                float dx = point.x - prev.x;
+                float dy = point.y - prev.y;
+                distances.push_back(distances.back() + std::sqrt(dx * dx + dy * dy));
+                samples.push_back(point);
+            }
         }
+        length = distances.back();
 
-        // Load the image into graphic memory using the SDL library
-        SDL_Texture* tex = SDL_CreateTextureFromSurface(rend, surf);
-
-        // Disposing of the surface now that it's in grahpic memory
-        SDL_FreeSurface(surf);  
-
-        // If the texture wasn't loaded into graphical memory correctly
-        if (!tex) 
+        // Resample at even distances
+        int count = (int) (length / step) + 2;
+        table.resize(count);
+        int j = 0;
+        for (int i = 0; i < count; i++) 
         {
-            SDL_DestroyRenderer(rend);
-            SDL_DestroyWindow(window);
-            SDL_Quit();
-            std::cerr << "Error Creating the texture: " 
-                      << SDL_GetError() 
-                      << std::endl;
+            float distance = std::min(i * step, length);
+            while (j + 2 < (int) samples.size() && distances[j + 1] < distance) j++;
+
+            float span = distances[j + 1] - distances[j];
+            float t = span > 0 ? (distance - distances[j]) / span : 0;
+            table[i] = Lerp(samples[j], samples[j + 1], t);
         }
+    }
 
-        return tex;
+    Vector2 Sample(float distance) const
+    {
+        if (distance >= length) return table.back();
+        if (distance <= 0) return table.front();
+
+        float index = distance / step;
+        int i = (int) index;
+        return Lerp(table[i], table[i + 1], index - i);
     }
 
-    void Quit() 
+    private:
+    static float CatmullRom(float p0, float p1, float p2, float p3, float t)
     {
-        // Quit the SDL
-        SDL_DestroyRenderer(rend);
-        SDL_DestroyWindow(window);
-        SDL_Quit();
+        return 0.5f * (2 * p1 + 
+                       (p2 - p0) * t + 
+                       (2 * p0 - 5 * p1 + 4 * p2 - p3) * t * t + 
+                       (3 * p1 - p0 - 3 * p2 + p3) * t * t * t);
     }
-};
-// -----------------------------------------------------------------------------
 
-// -----------------------------------------------------------------------------
-// Objects
+    static Vector2 Lerp(const Vector2& a, const Vector2& b, float t)
+    {
+        return Vector2(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t);
+    }
+};
 
-class Scene
+// Lock-free ring buffer for handing items from exactly one producer thread to
+// exactly one consumer thread. Capacity must be a power of two.
+template <typename T, unsigned int Capacity>
+class SPSCQueue
 {
     public:
-    Frame mainFrame;
-    Frame killLogFrame;
-    Grid mainGrid;
-    Grid killLogGrid;
-    std::vector<std::vector<SDL_Rect*>> killLogList;
+    SPSCQueue():
+        head(0),
+        tail(0)
+    {}
 
-    Scene()
+    // Producer side, returns false if the queue is full
+    bool Push(const T& item)
     {
-        mainFrame.origin = Vector2Int(8, 8);
-        mainFrame.size = Vector2Int(720, 704);
-
-        mainGrid.dim = Vector2Int(8, 6);
-        mainGrid.elemSize = Vector2Int(90, 90);
-        mainGrid.MakeColPosArray();
-        mainGrid.MakeRowPosArray();
+        const unsigned int h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= Capacity) return false;
 
-        killLogFrame.origin = Vector2Int(750, 16);
-        killLogFrame.size = Vector2Int(208, 489);
-
-        killLogGrid.origin = killLogFrame.origin;
-        killLogGrid.dim = Vector2Int(1, 10);
-        killLogGrid.elemSize = Vector2Int(195, 48);
-        killLogGrid.MakeColPosArray();
-        killLogGrid.MakeRowPosArray();
+        items[h & (Capacity - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
     }
 
-    void AppendKillLog(SDL_Rect* logName, SDL_Rect* logValue)
+    // Consumer side, returns false if the queue is empty
+    bool Pop(T& item)
     {
-        // Kill Log entry
-        std::vector<SDL_Rect*> killLogEntry;
-        killLogEntry.push_back(logValue);
-        killLogEntry.push_back(logName);
+        const unsigned int t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return false;
 
-        if (killLogList.size() >= killLogGrid.dim.y)
-        {
-            killLogList.pop_back();
-        }
+        item = items[t & (Capacity - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
 
-        for (int i = 0; i < killLogList.size(); i++)
-        {
-            killLogList[i][0]->y = killLogGrid.rowPos[killLogGrid.rowPos.size() - 2 - i];
-            killLogList[i][1]->y = killLogGrid.rowPos[killLogGrid.rowPos.size() - 2 - i];
-        }
-        
-        killLogList.push_back(killLogEntry);
+    bool Empty() const
+    {
+        return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire);
     }
+
+    private:
+    T items[Capacity];
+    // Keep the two indices on separate cache lines so the threads don't fight
+    alignas(64) std::atomic<unsigned int> head;
+    alignas(64) std::atomic<unsigned int> tail;
 };
 
-class GameObject : public SDL_Rect
+// Storage for objects that come and go every few frames. Slots are allocated a
+// chunk at a time and recycled through a free list, so objects never move and
+// creating one stops touching the heap once the pool has warmed up.
+template<typename T, unsigned int ChunkSize = 64>
+class ObjectPool
 {
     public:
-    enum Type
-    {
-        ENEMY,
-        PROJECTILE,
-        PLAYER,
-        ROOT,
-        DEFAULT
-    };
+    ObjectPool():
+        liveCount(0)
+    {}
 
-    std::string name;
-    Type type = Type::DEFAULT;
-    SDL_Texture* tex;
-    SDL_General* SDL_Gen;
-    Scene* scene;
-    GameObject* root;
-    std::vector<GameObject*> children;
+    // Live objects hold pointers into the chunks, so the pool can't be copied
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
 
-    GameObject(const Vector2Int& inPos = Vector2Int(0, 0),
-               SDL_General* SDL_GenPtr = NULL,
-               Scene* scenePtr = NULL,
-               GameObject* rootPtr = NULL) :
-        children()
+    ~ObjectPool()
     {
-        // Set the position of the game object
-        x = inPos.x;
-        y = inPos.y;
+        for (int i = 0; i < chunks.size(); i++) delete[] chunks[i];
+    }
 
-        // Set the SDL General pointer
-        SDL_Gen = SDL_GenPtr;
+    // Copy construct a new object into a free slot
+    T* Create(const T& source)
+    {
+        if (freeSlots.empty()) Grow();
 
-        // Set the pointer to the scene object
-        scene = scenePtr;
+        void* slot = freeSlots.back();
+        freeSlots.pop_back();
+        liveCount++;
 
-        // Set the root pointer
-        root = rootPtr;
+        return new (slot) T(source);
     }
 
-    virtual void Process(const float& deltaTime) {}
-
-    virtual void Destroy() 
+    void Release(T* object)
     {
-        delete this;
+        object->~T();
+        freeSlots.push_back(object);
+        liveCount--;
     }
 
-    bool GetDestroyQueuedVal() { return destroyQueued; }
-    void SetDestroyQueuedVal(bool inVal) 
-    { 
-        destroyQueued = inVal; 
-    }
+    int GetLiveCount() const { return liveCount; }
+    int GetCapacity() const { return chunks.size() * ChunkSize; }
 
-    protected: 
-    bool destroyQueued = false;
+    private:
+    typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Slot;
+
+    std::vector<Slot*> chunks;
+    std::vector<void*> freeSlots;
+    int liveCount;
+
+    void Grow()
+    {
+        Slot* chunk = new Slot[ChunkSize];
+        chunks.push_back(chunk);
+
+        // Hand out the lowest slots first
+        for (int i = ChunkSize - 1; i >= 0; i--) freeSlots.push_back(&chunk[i]);
+    }
 };
 
-class TextObject : public GameObject
+// Severity levels, anything below LOG_MIN_LEVEL is compiled out entirely
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_LEVEL_INFO
+#endif
+
+#if defined(__GNUC__)
+#define LOG_PRINTF_FORMAT(fmtIndex, argIndex) __attribute__((format(printf, fmtIndex, argIndex)))
+#else
+#define LOG_PRINTF_FORMAT(fmtIndex, argIndex)
+#endif
+
+// Lets a call site through a fixed number of times per second and counts
+// what it holds back, so a message in a hot loop can't flood the log
+struct LogRateLimit
 {
-    public:
-    enum HorzAlign
+    std::atomic<Uint32> windowStart;
+    std::atomic<int> count;
+    std::atomic<int> suppressed;
+
+    LogRateLimit():
+        windowStart(0),
+        count(0),
+        suppressed(0)
+    {}
+
+    // Returns false to drop the message, otherwise how many were dropped
+    // since the last one let through
+    bool Allow(Uint32 nowMs, int perSecond, int& droppedSinceLast)
     {
-        LEFT,
-        CENTER,
-        RIGHT
-    };
+        if (nowMs - windowStart.load(std::memory_order_relaxed) >= 1000) 
+        {
+            windowStart.store(nowMs, std::memory_order_relaxed);
+            count.store(0, std::memory_order_relaxed);
+        }
 
-    TTF_Font* font;
-    HorzAlign horzAlign;
-    SDL_Color color;
-    Vector2Int pos;
+        if (count.fetch_add(1, std::memory_order_relaxed) >= perSecond) 
+        {
+            suppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
 
-    TextObject(const Vector2Int& inPos = Vector2Int(0, 0),
-          SDL_General* SDL_GenPtr = NULL,
-          Scene* scenePtr = NULL,
-          GameObject* rootPtr = NULL,
-          const char* message = NULL,
-          const char* fontFile = NULL,
-          int size = 24,
-          SDL_Color inColor = SDL_Color(),
-          HorzAlign inHorzAlign = HorzAlign::LEFT)
-        : GameObject(inPos, SDL_GenPtr, scenePtr, rootPtr)
+        droppedSinceLast = suppressed.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+};
+
+// Formats messages on the calling thread into that thread's own lock-free
+// ring, a background thread writes them out. Logging never waits on I/O, if
+// a ring fills up the message is dropped and counted instead.
+class Logger
+{
+    public:
+    static const int maxThreads = 64;
+    static const int ringSize = 256;
+    static const int messageSize = 160;
+    static const int rateLimitPerSecond = 20;
+
+    static Logger& Get()
     {
-        // If no message passed in
-        if (message == NULL) cerr << "No message given for text object!" << endl;
+        static Logger logger;
+        return logger;
+    }
 
-        // This opens a font style and sets a size
-        font = TTF_OpenFont(fontFile, size);
+    // Start flushing to the given file, or stderr if there's none
+    void Init(const char* filePath = NULL)
+    {
+        if (running.load()) return;
 
-        if ( !font ) 
+        output = stderr;
+        if (filePath != NULL) 
         {
-            std::cerr << "Error loading font: " << TTF_GetError() << std::endl;
+            output = std::fopen(filePath, "w");
+            if (output == NULL) 
+            {
+                std::fprintf(stderr, "Error opening log file: %s\n", filePath);
+                output = stderr;
+            }
         }
 
-        // Set the color
-        color = inColor;
+        running.store(true);
+        flusher = std::thread(&Logger::FlushLoop, this);
+    }
 
-        // Log the pos
-        pos = inPos;
+    LOG_PRINTF_FORMAT(4, 5)
+    void Write(int level, LogRateLimit& limit, const char* format, ...)
+    {
+        Uint32 now = GetTimeMs();
 
-        // Get the text as a SDL Texture
-        tex = SDL_Gen->CreateTextTexture(
-            font,
-            message,
-            color);
+        int droppedSinceLast = 0;
+        if (!limit.Allow(now, rateLimitPerSecond, droppedSinceLast)) return;
 
-        // Get the dimensions of the sprite image
-        SDL_QueryTexture(tex, NULL, NULL, &w, &h);
+        Ring* ring = GetRing();
+        if (ring == NULL) return;
 
-        // Check alignment
-        horzAlign = inHorzAlign;
-        AdjustToHorzAlignment();
+        Record record;
+        record.timeMs = now;
+        record.level = level;
+        record.suppressed = droppedSinceLast;
+
+        va_list args;
+        va_start(args, format);
+        std::vsnprintf(record.text, sizeof(record.text), format, args);
+        va_end(args);
+
+        if (!ring->records.Push(record)) ring->dropped.fetch_add(1, std::memory_order_relaxed);
     }
-    
-    protected:
-    void AdjustToHorzAlignment()
+
+    // Write out everything still queued and stop the flush thread
+    void Quit()
     {
-        switch(horzAlign) 
-        {
-            case HorzAlign::RIGHT:
-                x = pos.x - w;
-                break;
-            case HorzAlign::CENTER:
-                x = pos.x - w / 2;
-                break;
-            default:
-                break;
-        }
+        if (!running.load()) return;
+
+        running.store(false);
+        flusher.join();
+
+        if (output != stderr) std::fclose(output);
+        output = stderr;
     }
 
     private:
-};
+    struct Record
+    {
+        Uint32 timeMs;
+        int level;
+        int suppressed;
+        char text[messageSize];
+    };
 
-class ScoreText : public TextObject
-{
-    public:
-    int value = 0;
+    struct Ring
+    {
+        SPSCQueue<Record, ringSize> records;
+        std::atomic<int> dropped;
 
-    ScoreText(const Vector2Int& inPos = Vector2Int(0, 0),
-          SDL_General* SDL_GenPtr = NULL,
-          Scene* scenePtr = NULL,
-          GameObject* rootPtr = NULL,
-          const char* message = NULL,
-          const char* fontFile = NULL,
-          int size = 24,
-          SDL_Color color = SDL_Color(),
-          HorzAlign inHorzAlign = HorzAlign::LEFT)
-        : TextObject(inPos, SDL_GenPtr, scenePtr, rootPtr, message, fontFile, size, color, inHorzAlign)
-    {}
+        Ring():
+            dropped(0)
+        {}
+    };
 
-    void UpdateValue(const int& inValue)
+    // A thread hands its ring back when it exits, whatever it queued still gets flushed
+    Ring rings[maxThreads];
+    std::atomic<bool> ringInUse[maxThreads];
+    std::chrono::steady_clock::time_point startTime;
+    FILE* output;
+    std::atomic<bool> running;
+    std::thread flusher;
+
+    Logger():
+        startTime(std::chrono::steady_clock::now()),
+        output(stderr),
+        running(false)
     {
-        value += inValue;
+        for (int i = 0; i < maxThreads; i++) ringInUse[i].store(false);
+    }
 
-        // Get the text as a SDL Texture
-        tex = SDL_Gen->CreateTextTexture(
-            font,
-            to_string(value).c_str(),
-            color);
+    ~Logger()
+    {
+        Quit();
+    }
 
-        // Get the dimensions of the sprite image
-        SDL_QueryTexture(tex, NULL, NULL, &w, &h);
+    Uint32 GetTimeMs() const
+    {
+        return (Uint32) std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - startTime).count();
+    }
 
-        // Set the alignment
-        AdjustToHorzAlignment();
+    // Holds a thread's ring and returns it when the thread exits
+    struct RingClaim
+    {
+        int index;
+        bool warned;
+
+        RingClaim():
+            index(-1),
+            warned(false)
+        {}
+
+        ~RingClaim()
+        {
+            if (index >= 0) Logger::Get().ringInUse[index].store(false, std::memory_order_release);
+        }
+    };
+
+    // Each thread claims a free ring the first time it logs
+    Ring* GetRing()
+    {
+        static thread_local RingClaim claim;
+        if (claim.index >= 0) return &rings[claim.index];
+
+        for (int i = 0; i < maxThreads; i++) 
+        {
+            bool expected = false;
+            if (ringInUse[i].compare_exchange_strong(expected, true, std::memory_order_acquire)) 
+            {
+                claim.index = i;
+                return &rings[i];
+            }
+        }
+
+        // Keep trying on later writes in case another thread exits
+        if (!claim.warned) 
+        {
+            claim.warned = true;
+            std::fprintf(stderr, "Logger: more than %d threads are logging at once, "
+                                 "messages from this thread are dropped until one exits\n", (int) maxThreads);
+        }
+        return NULL;
     }
 
-    private:
+    void Flush()
+    {
+        static const char* levelNames[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+
+        // Rings given back by exited threads may still hold records
+        for (int i = 0; i < maxThreads; i++) 
+        {
+            Ring* ring = &rings[i];
+
+            Record record;
+            while (ring->records.Pop(record)) 
+            {
+                if (record.suppressed > 0) 
+                {
+                    std::fprintf(output, "[%8u] %-5s (%d similar messages suppressed)\n",
+                                 record.timeMs, levelNames[record.level], record.suppressed);
+                }
+                std::fprintf(output, "[%8u] %-5s %s\n", record.timeMs, levelNames[record.level], record.text);
+            }
+
+            int dropped = ring->dropped.exchange(0, std::memory_order_relaxed);
+            if (dropped > 0) std::fprintf(output, "%d log messages dropped, ring %d was full\n", dropped, i);
+        }
+
+        std::fflush(output);
+    }
+
+    void FlushLoop()
+    {
+        while (true) 
+        {
+            // Read the flag first so nothing logged before Quit() is missed
+            bool keepRunning = running.load();
+
+            Flush();
+            if (!keepRunning) return;
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
 };
 
-class SpriteObject : public GameObject
+// Each call site gets its own rate limit
+#define LOG_AT_LEVEL(level, ...) \
+    do { \
+        static LogRateLimit logRateLimit; \
+        Logger::Get().Write(level, logRateLimit, __VA_ARGS__); \
+    } while (0)
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) LOG_AT_LEVEL(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do {} while (0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) LOG_AT_LEVEL(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) do {} while (0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(...) LOG_AT_LEVEL(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) do {} while (0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) LOG_AT_LEVEL(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) do {} while (0)
+#endif
+
+// -----------------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+// ENGINE TOOLS
+
+// Software mixer for the sound effects. Every effect is decoded once into the
+// device format at load time, then the audio callback mixes the active voices
+// from that cache. The game thread only pushes play commands onto a lock-free
+// queue, so the callback never locks or allocates.
+//
+// Runs headless with SDL_AUDIODRIVER=dummy (or =disk plus SDL_DISKAUDIOFILE to
+// capture the mixed output).
+class SoundMixer
 {
     public:
-    SpriteObject(const Vector2Int& inPos = Vector2Int(0, 0),
-          SDL_General* SDL_GenPtr = NULL,
-          Scene* scenePtr = NULL,
-          GameObject* rootPtr = NULL,
-          const char* spriteFile = NULL)
-        : GameObject(inPos, SDL_GenPtr, scenePtr, rootPtr)
+    enum Sound
     {
-        // Set the game object's sprite
-        if (spriteFile != NULL) {
-            if (SDL_Gen == NULL) std::cerr << "SDL Gen is NULL" << std::endl;
+        LASER_FIRED,
+        ALIEN_HIT,
+        ALIEN_KILLED,
+        SOUND_COUNT
+    };
+
+    static const int sampleRate = 44100;
+    static const int maxVoices = 8;
 
-            // Load in the following texture
-            tex = SDL_Gen->LoadTexture(spriteFile);
+    SoundMixer():
+        device(0),
+        droppedCommands(0)
+    {}
 
-            // Get the dimensions of the sprite image
-            SDL_QueryTexture(tex, NULL, NULL, &w, &h);
+    void Init()
+    {
+        // Audio is optional, the game still runs if there is no device
+        if (SDL_InitSubSystem(SDL_INIT_AUDIO) != 0) 
+        {
+            LOG_ERROR("Couldn't initialize audio: %s", SDL_GetError());
+            return;
         }
-    }
 
-    private:
-};
+        SDL_AudioSpec desired;
+        std::memset(&desired, 0, sizeof(desired));
+        desired.freq = sampleRate;
+        desired.format = AUDIO_S16SYS;
+        desired.channels = 1;
+        desired.samples = 512;
+        desired.callback = AudioCallback;
+        desired.userdata = this;
+
+        // No allowed changes, SDL converts to the real device format for us
+        device = SDL_OpenAudioDevice(NULL, 0, &desired, NULL, 0);
+        if (device == 0) 
+        {
+            LOG_ERROR("Error opening audio device: %s", SDL_GetError());
+            return;
+        }
 
-class Laser : public SpriteObject {
-    public:
-    Laser(const Vector2Int& inPos = Vector2Int(0, 0),
-          SDL_General* SDL_GenPtr = NULL,
-          Scene* scenePtr = NULL,
-          GameObject* rootPtr = NULL,
-          const char* spriteFile = NULL)
-        : SpriteObject(inPos, SDL_GenPtr, scenePtr, rootPtr, spriteFile)
+        for (int i = 0; i < maxVoices; i++) voices[i].data = NULL;
+        SDL_PauseAudioDevice(device, 0);
+    }
+
+    // Decode a WAV file into the sample cache, call before the game loop
+    void LoadSample(Sound sound, const char* wavFile)
     {
-        pos.x = (float) x;
-        pos.y = (float) y;
+        SDL_AudioSpec wavSpec;
+        Uint8* wavBuffer = NULL;
+        Uint32 wavLength = 0;
 
-        type = Type::PROJECTILE;
+        if (SDL_LoadWAV(wavFile, &wavSpec, &wavBuffer, &wavLength) == NULL) 
+        {
+            LOG_ERROR("Error loading sound: %s %s", wavFile, SDL_GetError());
+            return;
+        }
+
+        // Convert to the mixer's format
+        SDL_AudioCVT cvt;
+        SDL_BuildAudioCVT(
+            &cvt,
+            wavSpec.format, wavSpec.channels, wavSpec.freq,
+            AUDIO_S16SYS, 1, sampleRate);
+
+        std::vector<Uint8> converted(wavLength * (cvt.needed ? cvt.len_mult : 1));
+        std::memcpy(converted.data(), wavBuffer, wavLength);
+        SDL_FreeWAV(wavBuffer);
+
+        int convertedLength = wavLength;
+        if (cvt.needed) 
+        {
+            cvt.buf = converted.data();
+            cvt.len = wavLength;
+            if (SDL_ConvertAudio(&cvt) != 0) 
+            {
+                LOG_ERROR("Error converting sound: %s %s", wavFile, SDL_GetError());
+                return;
+            }
+            convertedLength = cvt.len_cvt;
+        }
+
+        // Only write the cache while the callback can't be reading it
+        if (device != 0) SDL_LockAudioDevice(device);
+        samples[sound].assign(
+            (const Sint16*) converted.data(),
+            (const Sint16*) converted.data() + convertedLength / sizeof(Sint16));
+        if (device != 0) SDL_UnlockAudioDevice(device);
     }
 
-    void Process(const float& deltaTime) override
+    // Called from the game thread, never blocks
+    void Play(Sound sound, int volume = SDL_MIX_MAXVOLUME)
     {
-        // Update the Up Time
-        upTime += deltaTime;
-        if (upTime >= maxTime) SetDestroyQueuedVal(true);
+        if (device == 0) return;
 
-        // Check if the laer is colliding with an enemy
-        if (IsCollidingWithEnemy(root)) SetDestroyQueuedVal(true);
+        PlayCommand command;
+        command.sound = sound;
+        command.volume = volume;
+        if (!commands.Push(command)) droppedCommands++;
+    }
 
-        // Update the position
-        pos.y -= speed * deltaTime;
+    int GetDroppedCommands() const { return droppedCommands; }
 
-        // Set the position of the dest
-        y = (int) pos.y;
+    void Quit()
+    {
+        if (device == 0) return;
+
+        SDL_CloseAudioDevice(device);
+        device = 0;
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
     }
 
     private:
-    Vector2 pos;
-    float speed = 600;
-    float upTime = 0;
-    float maxTime = 2.0f;
+    struct PlayCommand
+    {
+        int sound;
+        int volume;
+    };
 
-    bool IsCollidingWithEnemy(GameObject* node)
+    struct Voice
     {
-        // Loop through the children 
-        for (int i = 0; i < node->children.size(); i++) 
+        const Sint16* data;
+        int length;
+        int position;
+        int volume;
+    };
+
+    SDL_AudioDeviceID device;
+    std::vector<Sint16> samples[SOUND_COUNT];
+    Voice voices[maxVoices];
+    SPSCQueue<PlayCommand, 64> commands;
+    int droppedCommands;
+
+    static void AudioCallback(void* userdata, Uint8* stream, int len)
+    {
+        ((SoundMixer*) userdata)->Mix((Sint16*) stream, len / sizeof(Sint16));
+    }
+
+    void StartVoice(const PlayCommand& command)
+    {
+        const std::vector<Sint16>& sample = samples[command.sound];
+        if (sample.empty()) return;
+
+        // Take a free voice, or steal the one closest to finishing
+        int chosen = 0;
+        int mostPlayed = -1;
+        for (int i = 0; i < maxVoices; i++) 
         {
-            if (IsCollidingWithEnemy(node->children[i])) return true;
+            if (voices[i].data == NULL) 
+            {
+                chosen = i;
+                break;
+            }
+
+            int played = voices[i].position * 256 / voices[i].length;
+            if (played > mostPlayed) 
+            {
+                mostPlayed = played;
+                chosen = i;
+            }
         }
 
-        // If not an enemy then return false
-        if (node->type != GameObject::Type::ENEMY) return false;
+        voices[chosen].data = sample.data();
+        voices[chosen].length = (int) sample.size();
+        voices[chosen].position = 0;
+        voices[chosen].volume = command.volume;
+    }
+
+    void Mix(Sint16* out, int sampleCount)
+    {
+        // Start anything the game asked for since the last callback
+        PlayCommand command;
+        while (commands.Pop(command)) StartVoice(command);
+
+        for (int s = 0; s < sampleCount; s++) 
+        {
+            int mixed = 0;
+            for (int i = 0; i < maxVoices; i++) 
+            {
+                Voice& voice = voices[i];
+                if (voice.data == NULL) continue;
+
+                mixed += voice.data[voice.position] * voice.volume / SDL_MIX_MAXVOLUME;
+                if (++voice.position >= voice.length) voice.data = NULL;
+            }
 
-        // No hits
-        return (SDL_HasIntersection(this, node));
+            // Clip to the 16 bit range
+            if (mixed > 32767) mixed = 32767;
+            if (mixed < -32768) mixed = -32768;
+            out[s] = (Sint16) mixed;
+        }
     }
 };
 
-class Alien : public SpriteObject
+// Hierarchical timer wheel for everything that fires after a delay. One tick
+// is a millisecond. Each level has 64 slots and covers 64 times the range of
+// the level below it, timers cascade down a level as their time gets close.
+// Scheduling, cancelling and firing are all O(1), and nothing is checked on a
+// frame unless it is actually due.
+class TimerWheel
 {
     public:
-    Alien(const Vector2Int& inPos = Vector2Int(0, 0),
-          SDL_General* SDL_GenPtr = NULL,
-          Scene* scenePtr = NULL,
-          GameObject* rootPtr = NULL,
-          const char* spriteFile = NULL)
-        : SpriteObject(inPos, SDL_GenPtr, scenePtr, rootPtr, spriteFile)
+    typedef std::function<void()> Callback;
+
+    struct Handle
     {
-        // Set the game object type
-        type = Type::ENEMY;
+        int index;
+        Uint32 generation;
 
-        // Get the score value ptr
-        DigForScoreValue(root);
+        Handle():
+            index(-1),
+            generation(0)
+        {}
+    };
+
+    static const int levelCount = 4;
+    static const int slotBits = 6;
+    static const int slotCount = 1 << slotBits;
+
+    TimerWheel():
+        now(0),
+        pendingTime(0),
+        firing(-1)
+    {
+        for (int i = 0; i < totalSlots; i++) heads[i] = -1;
     }
 
-    void Process(const float& deltaTime) override
+    // Run the callback after delayMs, then every intervalMs if it is not 0
+    Handle Schedule(Uint32 delayMs, const Callback& callback, Uint32 intervalMs = 0)
     {
-        // Check if the alien is being hit by a projectile
-        if (IsHit(root)) TakeDamage();
+        int index;
+        if (!freeTimers.empty()) 
+        {
+            index = freeTimers.back();
+            freeTimers.pop_back();
+        }
+        else 
+        {
+            index = (int) timers.size();
+            timers.push_back(Timer());
+        }
 
-        // Check if the alien is dead
-        if (health <= 0) 
+        Timer& timer = timers[index];
+        timer.callback = callback;
+        timer.expires = now + std::max<Uint32>(delayMs, 1);
+        timer.interval = intervalMs;
+        Insert(index);
+
+        Handle handle;
+        handle.index = index;
+        handle.generation = timer.generation;
+        return handle;
+    }
+
+    void Cancel(Handle& handle)
+    {
+        if (IsActive(handle)) 
+        {
+            Unlink(handle.index);
+            Release(handle.index);
+        }
+        else if (handle.index >= 0 && handle.index == firing &&
+                 timers[handle.index].generation == handle.generation) 
         {
-            // Update the hill log
-            // SDL_Color color = {255, 100, 60, 255};
-            SDL_Color color = {100, 255, 150, 255};
-
-            TextObject* logName = new TextObject(
-                Vector2Int(
-                    scene->killLogGrid.colPos[0], 
-                    scene->killLogGrid.rowPos[scene->killLogGrid.rowPos.size() - 1]),
-                SDL_Gen,
-                scene,
-                root,
-                name.c_str(),
-                "resources/Born2bSportyV2.ttf",
-                32,
-                color);
-            logName->name = "Kill-Log-Name";
-            root->children.push_back(logName);
-
-            std::string valMod = "+";
-
-            TextObject* logValue = new TextObject(
-                Vector2Int(
-                    scene->killLogGrid.origin.x + scene->killLogGrid.elemSize.x, 
-                    scene->killLogGrid.rowPos[scene->killLogGrid.rowPos.size() - 1]),
-                SDL_Gen,
-                scene,
-                root,
-                (valMod + to_string(pointValue)).c_str(),
-                "resources/Born2bSportyV2.ttf",
-                32,
-                color,
-                TextObject::HorzAlign::RIGHT);
-            logValue->name = "Kill-Log-Value";
-            root->children.push_back(logValue);
-
-            scene->AppendKillLog(logName, logValue);
-
-            // Update the score value
-            scoreValue->UpdateValue(pointValue);
+            // Cancelled from its own callback, Tick sees the new generation and skips the re-arm
+            Release(handle.index);
+        }
 
-            // Queue destruction
-            SetDestroyQueuedVal(true);
+        handle = Handle();
+    }
+
+    bool IsActive(const Handle& handle) const
+    {
+        return handle.index >= 0 &&
+               timers[handle.index].generation == handle.generation &&
+               timers[handle.index].slot >= 0;
+    }
+
+    // Milliseconds until the timer next fires
+    Uint32 Remaining(const Handle& handle) const
+    {
+        if (!IsActive(handle)) return 0;
+        return (Uint32) (timers[handle.index].expires - now);
+    }
+
+    // Move time forward, firing everything that comes due
+    void Advance(float seconds)
+    {
+        pendingTime += seconds * 1000.0;
+        while (pendingTime >= 1.0) 
+        {
+            pendingTime -= 1.0;
+            Tick();
         }
     }
 
-    bool IsHit(GameObject* node)
+    Uint64 GetNow() const { return now; }
+
+    // The part of a millisecond Advance hasn't ticked yet, snapshots keep it
+    // so restored timers fire on the same frames
+    double GetPendingTime() const { return pendingTime; }
+    void SetPendingTime(double inPendingTime) { pendingTime = inPendingTime; }
+
+    private:
+    // One extra list holds timers that are mid-way through firing
+    static const int totalSlots = levelCount * slotCount + 1;
+    static const int firingSlot = totalSlots - 1;
+
+    struct Timer
     {
-        // Loop over the projectiles
-        for (int i = 0; i < node->children.size(); i++) {
-            if (IsHit(node->children[i])) return true;
+        Callback callback;
+        Uint64 expires;
+        Uint32 interval;
+        Uint32 generation;
+        int slot;
+        int prev;
+        int next;
+
+        Timer():
+            expires(0),
+            interval(0),
+            generation(0),
+            slot(-1),
+            prev(-1),
+            next(-1)
+        {}
+    };
+
+    std::vector<Timer> timers;
+    std::vector<int> freeTimers;
+    int heads[totalSlots];
+    Uint64 now;
+    double pendingTime;
+    int firing;
+
+    void Insert(int index)
+    {
+        Timer& timer = timers[index];
+        Uint64 delta = timer.expires - now;
+
+        // Pick the lowest level whose range reaches the expiry
+        int level = 0;
+        while (level < levelCount - 1 && delta >= ((Uint64) 1 << (slotBits * (level + 1)))) level++;
+
+        // Beyond the top level's range just park it in the furthest slot
+        Uint64 expires = timer.expires;
+        if (delta >= ((Uint64) 1 << (slotBits * levelCount))) 
+        {
+            expires = now + ((Uint64) 1 << (slotBits * levelCount)) - 1;
         }
 
-        // If not projectile then return false
-        if (node->type != GameObject::Type::PROJECTILE) return false;
+        int slot = level * slotCount + (int) ((expires >> (slotBits * level)) & (slotCount - 1));
+        Link(index, slot);
+    }
 
-        // No hits
-        return (SDL_HasIntersection(this, node));
+    void Link(int index, int slot)
+    {
+        Timer& timer = timers[index];
+        timer.slot = slot;
+        timer.prev = -1;
+        timer.next = heads[slot];
+        if (heads[slot] >= 0) timers[heads[slot]].prev = index;
+        heads[slot] = index;
     }
 
-    void TakeDamage()
+    void Unlink(int index)
     {
-        // Tick the health 
-        health -= 1;
+        Timer& timer = timers[index];
+        if (timer.prev >= 0) timers[timer.prev].next = timer.next;
+        else heads[timer.slot] = timer.next;
+        if (timer.next >= 0) timers[timer.next].prev = timer.prev;
+
+        timer.slot = -1;
+        timer.prev = -1;
+        timer.next = -1;
     }
 
-    private:
-    int health = 2;
-    int pointValue = 10;
-    ScoreText* scoreValue;
+    void Release(int index)
+    {
+        timers[index].callback = Callback();
+        timers[index].generation++;
+        freeTimers.push_back(index);
+    }
 
-    void DigForScoreValue(GameObject* node)
+    // Re-file every timer in a slot, they land on a lower level
+    void Cascade(int slot)
     {
-        for (int i = 0; i < node->children.size(); i++) 
+        int index = heads[slot];
+        heads[slot] = -1;
+
+        while (index >= 0) 
+        {
+            int next = timers[index].next;
+            Insert(index);
+            index = next;
+        }
+    }
+
+    void Tick()
+    {
+        now++;
+
+        // Each time a level wraps, pull the next slot down from the level above
+        for (int level = 1; level < levelCount; level++) 
         {
-            DigForScoreValue(node->children[i]);
+            if ((now & (((Uint64) 1 << (slotBits * level)) - 1)) != 0) break;
+            Cascade(level * slotCount + (int) ((now >> (slotBits * level)) & (slotCount - 1)));
         }
 
-        if (node->name == "Score-Value") scoreValue = (ScoreText*) node;
+        // Move the due timers to the firing list so callbacks can cancel any of them
+        int slot = (int) (now & (slotCount - 1));
+        while (heads[slot] >= 0) 
+        {
+            int index = heads[slot];
+            Unlink(index);
+            Link(index, firingSlot);
+        }
+
+        while (heads[firingSlot] >= 0) 
+        {
+            int index = heads[firingSlot];
+            Unlink(index);
+
+            Uint32 generation = timers[index].generation;
+            Callback callback = timers[index].callback;
+            firing = index;
+            callback();
+            firing = -1;
+
+            // Re-arm repeating timers unless the callback cancelled them
+            if (timers[index].generation != generation || timers[index].slot >= 0) continue;
+            if (timers[index].interval > 0) 
+            {
+                timers[index].expires = now + timers[index].interval;
+                Insert(index);
+            }
+            else 
+            {
+                Release(index);
+            }
+        }
     }
 };
 
-class EnemySpawner : public GameObject
+// Paces the main loop and measures how even the frames actually are.
+//   VSYNC    - present blocks on the display, the pacer only measures
+//   CAPPED   - sleep until just before the frame deadline, then spin to it
+//   UNCAPPED - run as fast as possible
+class FramePacer
 {
     public:
-    EnemySpawner(const Vector2Int& inPos = Vector2Int(0, 0),
-                 SDL_General* SDL_GenPtr = NULL,
-                 Scene* scenePtr = NULL,
-                 GameObject* rootPtr = NULL)
-        : GameObject(inPos, SDL_GenPtr, scenePtr, rootPtr)
-    {}
-
-    void Process(const float& deltaTime) override
+    enum Mode
     {
-        elapsedTime += deltaTime;
-        if (elapsedTime < spawnDelay) return;
+        VSYNC,
+        CAPPED,
+        UNCAPPED
+    };
+
+    struct Stats
+    {
+        int frames;
+        int missedDeadlines;
+        double meanIntervalMs;
+        double jitterMs;        // Standard deviation of the frame interval
+        double worstIntervalMs;
+    };
+
+    FramePacer(Mode inMode = VSYNC, int inTargetFps = 60):
+        mode(inMode),
+        targetFps(inTargetFps),
+        refreshRate(0),
+        frequency(0),
+        period(0),
+        lastFrame(0),
+        deadline(0),
+        varianceSum(0)
+    {
+        std::memset(&stats, 0, sizeof(stats));
+    }
+
+    bool UsesVsync() const { return mode == VSYNC; }
+
+    // The display's refresh rate, vsync frames are measured against it. 0 if unknown
+    void SetRefreshRate(int hz) { refreshRate = hz; }
+
+    // Call once right before the first frame
+    void Start()
+    {
+        frequency = SDL_GetPerformanceFrequency();
+        period = frequency / GetPacedFps();
+        lastFrame = SDL_GetPerformanceCounter();
+        deadline = lastFrame + period;
+    }
+
+    // Call at the end of each frame, returns the time the frame took in seconds
+    float EndFrame()
+    {
+        Uint64 current = SDL_GetPerformanceCounter();
+
+        if (mode == CAPPED) 
+        {
+            if (current > deadline) 
+            {
+                // Too late, start the schedule over from now rather than rushing
+                stats.missedDeadlines++;
+                deadline = current;
+            }
+            else 
+            {
+                WaitUntil(deadline);
+                current = SDL_GetPerformanceCounter();
+            }
+            deadline += period;
+        }
+        else if (mode == VSYNC && current - lastFrame > period + period / 2) 
+        {
+            // Took longer than a refresh and a half, so a refresh was skipped
+            stats.missedDeadlines++;
+        }
+
+        double intervalMs = (double) (current - lastFrame) * 1000.0 / frequency;
+        lastFrame = current;
+        Record(intervalMs);
+
+        // Don't let a long stall teleport everything
+        return (float) std::min(intervalMs / 1000.0, 0.1);
+    }
+
+    const Stats& GetStats() const { return stats; }
+
+    void PrintStats() const
+    {
+        const char* modeNames[] = {"vsync", "capped", "uncapped"};
+        std::cout << "Frame pacing (" << modeNames[mode] << ", " << GetPacedFps() << " fps): "
+                  << stats.frames << " frames"
+                  << ", mean " << stats.meanIntervalMs << " ms"
+                  << ", jitter " << stats.jitterMs << " ms"
+                  << ", worst " << stats.worstIntervalMs << " ms"
+                  << ", missed " << stats.missedDeadlines
+                  << std::endl;
+    }
+
+    private:
+    // How long before the deadline to stop sleeping and start spinning
+    static const int spinMarginMs = 2;
+
+    Mode mode;
+    int targetFps;
+    int refreshRate;
+    Uint64 frequency;
+    Uint64 period;
+    Uint64 lastFrame;
+    Uint64 deadline;
+    double varianceSum;
+    Stats stats;
+
+    // Vsync runs at the display's rate when it is known
+    int GetPacedFps() const
+    {
+        return mode == VSYNC && refreshRate > 0 ? refreshRate : targetFps;
+    }
+
+    void WaitUntil(Uint64 target)
+    {
+        // Sleep off most of the wait, the OS scheduler isn't precise
+        Uint64 current = SDL_GetPerformanceCounter();
+        Uint64 margin = frequency * spinMarginMs / 1000;
+        if (target > current + margin) 
+        {
+            SDL_Delay((Uint32) ((target - current - margin) * 1000 / frequency));
+        }
+
+        // Spin the rest
+        while (SDL_GetPerformanceCounter() < target) {}
+    }
+
+    void Record(double intervalMs)
+    {
+        // Running mean and variance
+        stats.frames++;
+        double delta = intervalMs - stats.meanIntervalMs;
+        stats.meanIntervalMs += delta / stats.frames;
+        varianceSum += delta * (intervalMs - stats.meanIntervalMs);
+
+        stats.jitterMs = stats.frames > 1 ? std::sqrt(varianceSum / (stats.frames - 1)) : 0;
+        stats.worstIntervalMs = std::max(stats.worstIntervalMs, intervalMs);
+    }
+};
+
+// Something that happened in the game that other systems react to
+struct GameEvent
+{
+    enum Type
+    {
+        ENEMY_KILLED,
+        PROJECTILE_FIRED,
+        SCORE_CHANGED
+    };
+
+    Type type;
+    int value;      // Points for a kill, the new total for a score change
+    char name[16];  // Name of the killed enemy
+
+    static GameEvent Make(Type inType, int inValue = 0, const std::string& inName = "")
+    {
+        GameEvent event;
+        event.type = inType;
+        event.value = inValue;
+        std::strncpy(event.name, inName.c_str(), sizeof(event.name) - 1);
+        event.name[sizeof(event.name) - 1] = '\0';
+        return event;
+    }
+};
+
+class GameEventListener
+{
+    public:
+    virtual ~GameEventListener() {}
+
+    // Called once a frame with every event pushed during it
+    virtual void OnGameEvents(const GameEvent* events, int count) = 0;
+};
+
+// Gameplay code pushes events into a fixed buffer as they happen, then once a
+// frame they are handed to each listener in a single batch. Lets consumers
+// like the score and kill log do one update per frame no matter how many
+// events came in. Events pushed while dispatching land in the next frame.
+class GameEventBus
+{
+    public:
+    static const int capacity = 256;
+
+    GameEventBus():
+        writeBuffer(0),
+        droppedEvents(0)
+    {
+        counts[0] = 0;
+        counts[1] = 0;
+    }
+
+    void Push(const GameEvent& event)
+    {
+        int& count = counts[writeBuffer];
+        if (count >= capacity) 
+        {
+            droppedEvents++;
+            return;
+        }
+
+        buffers[writeBuffer][count++] = event;
+    }
+
+    void Subscribe(GameEventListener* listener)
+    {
+        listeners.push_back(listener);
+    }
+
+    void Unsubscribe(GameEventListener* listener)
+    {
+        listeners.erase(std::remove(listeners.begin(), listeners.end(), listener), listeners.end());
+    }
+
+    // Deliver this frame's events
+    void Dispatch()
+    {
+        int readBuffer = writeBuffer;
+        writeBuffer = 1 - writeBuffer;
+        counts[writeBuffer] = 0;
+
+        if (counts[readBuffer] == 0) return;
+
+        for (int i = 0; i < listeners.size(); i++) 
+        {
+            listeners[i]->OnGameEvents(buffers[readBuffer], counts[readBuffer]);
+        }
+    }
+
+    int GetDroppedEvents() const { return droppedEvents; }
+
+    private:
+    GameEvent buffers[2][capacity];
+    int counts[2];
+    int writeBuffer;
+    int droppedEvents;
+    std::vector<GameEventListener*> listeners;
+};
+
+// Keeps count of every live texture, font and game object along with where it
+// was created, so leaks and memory growth show up in the stats and at Quit().
+class ResourceTracker
+{
+    public:
+    enum Kind
+    {
+        TEXTURE,
+        FONT,
+        OBJECT,
+        KIND_COUNT
+    };
+
+    struct Stats
+    {
+        int live[KIND_COUNT];
+        int peak[KIND_COUNT];
+        size_t textureBytes;
+        size_t peakTextureBytes;
+    };
+
+    ResourceTracker()
+    {
+        std::memset(&stats, 0, sizeof(stats));
+    }
+
+    void TrackTexture(const void* tex, int texW, int texH, const std::string& site)
+    {
+        if (tex == NULL) return;
+
+        // Estimate the size as 32 bit pixels, which is what SDL uploads
+        Track(tex, TEXTURE, site, NULL, (size_t) texW * texH * 4);
+    }
+
+    void TrackFont(TTF_Font* font, const std::string& site)
+    {
+        if (font == NULL) return;
+        Track(font, FONT, site, NULL, 0);
+    }
+
+    // Objects are reported by name, which is usually set after construction
+    void TrackObject(const void* object, const std::string* name)
+    {
+        Track(object, OBJECT, "", name, 0);
+    }
+
+    // Copies of a prefab are counted on the prototype's record, so spawning
+    // one from a warm pool doesn't allocate
+    void CountCopy(const void* prototype, int delta)
+    {
+        std::map<const void*, Record>::iterator it = live.find(prototype);
+        if (it == live.end()) return;
+
+        it->second.count += delta;
+        stats.live[OBJECT] += delta;
+        stats.peak[OBJECT] = std::max(stats.peak[OBJECT], stats.live[OBJECT]);
+
+        // The last copy of a prototype that's already gone
+        if (it->second.count == 0) live.erase(it);
+    }
+
+    void Untrack(const void* resource)
+    {
+        std::map<const void*, Record>::iterator it = live.find(resource);
+        if (it == live.end()) return;
+
+        stats.live[it->second.kind]--;
+        stats.textureBytes -= it->second.bytes;
+
+        // Copies outliving their prototype are leaks, keep them under its name
+        Record& record = it->second;
+        if (--record.count > 0) 
+        {
+            if (record.name != NULL) record.site = *record.name;
+            record.name = NULL;
+            return;
+        }
+
+        live.erase(it);
+    }
+
+    const Stats& GetStats() const { return stats; }
+
+    void PrintStats() const
+    {
+        std::cout << "Textures: " << stats.live[TEXTURE] << " (peak " << stats.peak[TEXTURE] << ")"
+                  << ", texture memory: " << stats.textureBytes / 1024 << " KB"
+                  << " (peak " << stats.peakTextureBytes / 1024 << " KB)"
+                  << ", fonts: " << stats.live[FONT]
+                  << ", objects: " << stats.live[OBJECT] << " (peak " << stats.peak[OBJECT] << ")"
+                  << std::endl;
+    }
+
+    // Anything still alive is a leak, grouped by where it came from
+    void ReportLeaks() const
+    {
+        if (live.empty()) 
+        {
+            LOG_INFO("No leaked resources");
+            return;
+        }
+
+        const char* kindNames[KIND_COUNT] = {"Texture", "Font", "Object"};
+        std::map<std::string, int> counts;
+        std::map<std::string, size_t> bytes;
+
+        std::map<const void*, Record>::const_iterator it;
+        for (it = live.begin(); it != live.end(); it++) 
+        {
+            const Record& record = it->second;
+            std::string site = record.name != NULL ? *record.name : record.site;
+            std::string key = std::string(kindNames[record.kind]) + " from " + site;
+            counts[key] += record.count;
+            bytes[key] += record.bytes;
+        }
+
+        LOG_WARN("Leaked resources:");
+        std::map<std::string, int>::iterator count;
+        for (count = counts.begin(); count != counts.end(); count++) 
+        {
+            if (bytes[count->first] > 0) 
+            {
+                LOG_WARN("    %d x %s (%lu bytes)", count->second, count->first.c_str(), (unsigned long) bytes[count->first]);
+            }
+            else 
+            {
+                LOG_WARN("    %d x %s", count->second, count->first.c_str());
+            }
+        }
+    }
+
+    private:
+    struct Record
+    {
+        Kind kind;
+        size_t bytes;
+        std::string site;
+        const std::string* name;
+        int count;      // The resource plus any live copies counted on it
+    };
+
+    std::map<const void*, Record> live;
+    Stats stats;
+
+    void Track(const void* resource, Kind kind, const std::string& site, const std::string* name, size_t bytes)
+    {
+        Record& record = live[resource];
+        record.kind = kind;
+        record.bytes = bytes;
+        record.site = site;
+        record.name = name;
+        record.count = 1;
+
+        stats.live[kind]++;
+        stats.peak[kind] = std::max(stats.peak[kind], stats.live[kind]);
+        stats.textureBytes += bytes;
+        stats.peakTextureBytes = std::max(stats.peakTextureBytes, stats.textureBytes);
+    }
+};
+
+// One of the game's color palettes. Sprites are reduced to indexed color and
+// their colors, ranked darkest to lightest, are spread across the shades.
+struct ColorPalette
+{
+    enum TextColor
+    {
+        TEXT,
+        KILL_LOG,
+        TEXT_COLOR_COUNT
+    };
+
+    static const int shadeCount = 4;
+
+    const char* name;
+    bool keepSourceColors;
+    SDL_Color shades[shadeCount];
+    SDL_Color textColors[TEXT_COLOR_COUNT];
+};
+
+const int paletteCount = 5;
+
+const ColorPalette palettes[paletteCount] = {
+    {"Original", true,
+        {{0, 0, 0, 255}, {0, 0, 0, 255}, {0, 0, 0, 255}, {0, 0, 0, 255}},
+        {{255, 255, 255, 255}, {100, 255, 150, 255}}},
+    {"Pocket", false,
+        {{15, 56, 15, 255}, {48, 98, 48, 255}, {139, 172, 15, 255}, {155, 188, 15, 255}},
+        {{155, 188, 15, 255}, {139, 172, 15, 255}}},
+    {"Amber", false,
+        {{43, 17, 0, 255}, {128, 64, 0, 255}, {224, 128, 0, 255}, {255, 196, 64, 255}},
+        {{255, 196, 64, 255}, {224, 128, 0, 255}}},
+    {"Ice", false,
+        {{10, 20, 60, 255}, {40, 80, 160, 255}, {100, 170, 230, 255}, {220, 240, 255, 255}},
+        {{220, 240, 255, 255}, {100, 170, 230, 255}}},
+    {"Neon", false,
+        {{30, 0, 40, 255}, {110, 20, 120, 255}, {220, 60, 160, 255}, {255, 200, 230, 255}},
+        {{255, 200, 230, 255}, {220, 60, 160, 255}}}
+};
+
+// A texture as a render backend sees it. The SDL backend keeps a GPU handle,
+// the software backend keeps the pixels (ARGB8888) in main memory.
+struct Texture
+{
+    int w;
+    int h;
+    SDL_Texture* handle;
+    std::vector<Uint32> pixels;
+
+    Texture():
+        w(0),
+        h(0),
+        handle(NULL)
+    {}
+};
+
+// Everything the game needs to draw a frame. The world is always drawn at the
+// native resolution and scaled up to the window when presenting.
+class RenderBackend
+{
+    public:
+    virtual ~RenderBackend() {}
+
+    virtual bool Init(SDL_Window* window, int inNativeWidth, int inNativeHeight, Uint32 renderFlags) = 0;
+    virtual void Quit() = 0;
+
+    virtual Texture* CreateTexture(SDL_Surface* surface) = 0;
+    virtual void DestroyTexture(Texture* tex) = 0;
+
+    virtual void BeginFrame() = 0;
+    virtual void DrawSprite(const Texture* tex, const SDL_Rect& dest, const SDL_Color& tint) = 0;
+    virtual void PresentFrame() = 0;
+
+    // Copy the finished native frame out as ARGB8888, before presenting
+    virtual bool ReadPixels(Uint32* pixels) = 0;
+
+    protected:
+    int nativeWidth;
+    int nativeHeight;
+
+    // Largest integer scale that fits the window, the rest is letterboxed
+    void GetUpscaleRect(int outW, int outH, SDL_Rect& dest) const
+    {
+        int scale = std::min(outW / nativeWidth, outH / nativeHeight);
+        if (scale < 1) scale = 1;
+
+        dest.w = nativeWidth * scale;
+        dest.h = nativeHeight * scale;
+        dest.x = (outW - dest.w) / 2;
+        dest.y = (outH - dest.h) / 2;
+    }
+};
+
+// Draws through SDL's renderer into a native resolution target texture
+class SDLRenderBackend : public RenderBackend
+{
+    public:
+    SDLRenderBackend():
+        rend(NULL),
+        target(NULL)
+    {}
+
+    bool Init(SDL_Window* window, int inNativeWidth, int inNativeHeight, Uint32 renderFlags) override
+    {
+        nativeWidth = inNativeWidth;
+        nativeHeight = inNativeHeight;
+
+        // Create the Render Pointer
+        rend = SDL_CreateRenderer(window, -1, renderFlags | SDL_RENDERER_TARGETTEXTURE);
+
+        // Render Error Catch
+        if (!rend) 
+        {
+            LOG_ERROR("Error Creating the renderer: %s", SDL_GetError());
+            return false;
+        }
+
+        // Create the native resolution render target, sampled nearest
+        SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "0");
+        target = SDL_CreateTexture(
+            rend,
+            SDL_PIXELFORMAT_ARGB8888,
+            SDL_TEXTUREACCESS_TARGET,
+            nativeWidth,
+            nativeHeight);
+
+        if (!target) 
+        {
+            LOG_ERROR("Error Creating the render target: %s", SDL_GetError());
+            return false;
+        }
+
+        // Clear the Window by setting it black
+        SDL_RenderClear(rend);
+        return true;
+    }
+
+    void Quit() override
+    {
+        SDL_DestroyTexture(target);
+        SDL_DestroyRenderer(rend);
+        target = NULL;
+        rend = NULL;
+    }
+
+    Texture* CreateTexture(SDL_Surface* surface) override
+    {
+        SDL_Texture* handle = SDL_CreateTextureFromSurface(rend, surface);
+        if (!handle) 
+        {
+            LOG_ERROR("Error Creating the texture: %s", SDL_GetError());
+            return NULL;
+        }
+
+        Texture* tex = new Texture();
+        tex->handle = handle;
+        SDL_QueryTexture(handle, NULL, NULL, &tex->w, &tex->h);
+        return tex;
+    }
+
+    void DestroyTexture(Texture* tex) override
+    {
+        SDL_DestroyTexture(tex->handle);
+        delete tex;
+    }
+
+    // Point drawing at the native resolution target and clear it
+    void BeginFrame() override
+    {
+        SDL_SetRenderTarget(rend, target);
+        SDL_SetRenderDrawColor(rend, 0, 0, 0, 255);
+        SDL_RenderClear(rend);
+    }
+
+    void DrawSprite(const Texture* tex, const SDL_Rect& dest, const SDL_Color& tint) override
+    {
+        SDL_SetTextureColorMod(tex->handle, tint.r, tint.g, tint.b);
+        SDL_RenderCopy(rend, tex->handle, NULL, &dest);
+    }
+
+    // Upscale the frame to the window by a whole number and present it
+    void PresentFrame() override
+    {
+        SDL_SetRenderTarget(rend, NULL);
+        SDL_RenderClear(rend);
+
+        int outW, outH;
+        SDL_GetRendererOutputSize(rend, &outW, &outH);
+
+        SDL_Rect dest;
+        GetUpscaleRect(outW, outH, dest);
+        SDL_RenderCopy(rend, target, NULL, &dest);
+
+        // Swaps the render from the back buffer to the front
+        SDL_RenderPresent(rend);
+    }
+
+    // Reads back from the render target, which is still bound
+    bool ReadPixels(Uint32* pixels) override
+    {
+        if (SDL_RenderReadPixels(rend, NULL, SDL_PIXELFORMAT_ARGB8888, pixels, nativeWidth * sizeof(Uint32)) != 0) 
+        {
+            LOG_ERROR("Error reading pixels: %s", SDL_GetError());
+            return false;
+        }
+        return true;
+    }
+
+    private:
+    SDL_Renderer* rend;
+    SDL_Texture* target;
+};
+
+// Draws on the CPU into a native resolution framebuffer and copies it to the
+// window surface. Output is bit-exact on every machine, so frames can be
+// compared against golden images, and it skips SDL's generic software
+// renderer on machines without a GPU. Blending uses SSE2 when available.
+class SoftwareRenderBackend : public RenderBackend
+{
+    public:
+    SoftwareRenderBackend():
+        window(NULL)
+    {}
+
+    bool Init(SDL_Window* inWindow, int inNativeWidth, int inNativeHeight, Uint32 renderFlags) override
+    {
+        window = inWindow;
+        nativeWidth = inNativeWidth;
+        nativeHeight = inNativeHeight;
+        framebuffer.assign(nativeWidth * nativeHeight, 0);
+        rowBuffer.assign(nativeWidth, 0);
+        return true;
+    }
+
+    void Quit() override
+    {
+        framebuffer.clear();
+        window = NULL;
+    }
+
+    Texture* CreateTexture(SDL_Surface* surface) override
+    {
+        // Colorkeyed surfaces come out with a real alpha channel
+        SDL_Surface* argb = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+        if (!argb) 
+        {
+            LOG_ERROR("Error Creating the texture: %s", SDL_GetError());
+            return NULL;
+        }
+
+        Texture* tex = new Texture();
+        tex->w = argb->w;
+        tex->h = argb->h;
+        tex->pixels.resize(tex->w * tex->h);
+
+        SDL_LockSurface(argb);
+        for (int row = 0; row < tex->h; row++) 
+        {
+            std::memcpy(
+                &tex->pixels[row * tex->w],
+                (const Uint8*) argb->pixels + row * argb->pitch,
+                tex->w * sizeof(Uint32));
+        }
+        SDL_UnlockSurface(argb);
+        SDL_FreeSurface(argb);
+
+        return tex;
+    }
+
+    void DestroyTexture(Texture* tex) override
+    {
+        delete tex;
+    }
+
+    void BeginFrame() override
+    {
+        std::fill(framebuffer.begin(), framebuffer.end(), 0xFF000000);
+    }
+
+    // Nearest-neighbour scaled, alpha blended, tinted blit
+    void DrawSprite(const Texture* tex, const SDL_Rect& dest, const SDL_Color& tint) override
+    {
+        if (tex == NULL || tex->pixels.empty() || dest.w <= 0 || dest.h <= 0) return;
+
+        // Clip to the framebuffer
+        int x0 = std::max(dest.x, 0);
+        int y0 = std::max(dest.y, 0);
+        int x1 = std::min(dest.x + dest.w, nativeWidth);
+        int y1 = std::min(dest.y + dest.h, nativeHeight);
+        if (x0 >= x1 || y0 >= y1) return;
+
+        int count = x1 - x0;
+        for (int dy = y0; dy < y1; dy++) 
+        {
+            int srcY = (dy - dest.y) * tex->h / dest.h;
+            const Uint32* srcRow = &tex->pixels[srcY * tex->w];
+
+            // Unscaled rows are read straight from the texture
+            const Uint32* src;
+            if (dest.w == tex->w) 
+            {
+                src = srcRow + (x0 - dest.x);
+            }
+            else 
+            {
+                for (int dx = x0; dx < x1; dx++) 
+                {
+                    rowBuffer[dx - x0] = srcRow[(dx - dest.x) * tex->w / dest.w];
+                }
+                src = rowBuffer.data();
+            }
+
+            BlendRow(&framebuffer[dy * nativeWidth + x0], src, count, tint);
+        }
+    }
+
+    void PresentFrame() override
+    {
+        SDL_Surface* surface = SDL_GetWindowSurface(window);
+        if (!surface) return;
+
+        SDL_Rect dest;
+        GetUpscaleRect(surface->w, surface->h, dest);
+
+        SDL_FillRect(surface, NULL, SDL_MapRGB(surface->format, 0, 0, 0));
+
+        // The fast path only writes unclipped, so a window smaller than native goes through SDL
+        bool fits = dest.x >= 0 && dest.y >= 0;
+        if (fits && (surface->format->format == SDL_PIXELFORMAT_ARGB8888 ||
+                     surface->format->format == SDL_PIXELFORMAT_RGB888)) 
+        {
+            // Same layout, repeat each pixel and row by the scale
+            int scale = dest.w / nativeWidth;
+            SDL_LockSurface(surface);
+            for (int row = 0; row < nativeHeight; row++) 
+            {
+                const Uint32* src = &framebuffer[row * nativeWidth];
+                Uint32* first = (Uint32*) ((Uint8*) surface->pixels + (dest.y + row * scale) * surface->pitch) + dest.x;
+
+                for (int col = 0; col < nativeWidth; col++) 
+                {
+                    for (int s = 0; s < scale; s++) first[col * scale + s] = src[col];
+                }
+
+                for (int s = 1; s < scale; s++) 
+                {
+                    std::memcpy((Uint8*) first + s * surface->pitch, first, dest.w * sizeof(Uint32));
+                }
+            }
+            SDL_UnlockSurface(surface);
+        }
+        else 
+        {
+            // Let SDL convert and clip anything else
+            SDL_Surface* frame = SDL_CreateRGBSurfaceWithFormatFrom(
+                framebuffer.data(), nativeWidth, nativeHeight, 32,
+                nativeWidth * sizeof(Uint32), SDL_PIXELFORMAT_ARGB8888);
+            SDL_BlitScaled(frame, NULL, surface, &dest);
+            SDL_FreeSurface(frame);
+        }
+
+        SDL_UpdateWindowSurface(window);
+    }
+
+    bool ReadPixels(Uint32* pixels) override
+    {
+        std::memcpy(pixels, framebuffer.data(), framebuffer.size() * sizeof(Uint32));
+        return true;
+    }
+
+    // The finished frame, for golden image comparisons
+    const std::vector<Uint32>& GetFramebuffer() const { return framebuffer; }
+
+    private:
+    SDL_Window* window;
+    std::vector<Uint32> framebuffer;
+    std::vector<Uint32> rowBuffer;
+
+    // x / 255 rounded, exact for everything a blend can produce
+    static Uint32 Div255(Uint32 x)
+    {
+        x += 128;
+        return (x + (x >> 8)) >> 8;
+    }
+
+    // dst = src * tint * a + dst * (1 - a), per channel. The SIMD and scalar
+    // paths do the same integer math so they give identical results.
+    static void BlendRow(Uint32* dst, const Uint32* src, int count, const SDL_Color& tint)
+    {
+        int i = 0;
+
+#ifdef __SSE2__
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i full = _mm_set1_epi16(255);
+        const __m128i half = _mm_set1_epi16(128);
+        const __m128i tintMul = _mm_setr_epi16(
+            tint.b, tint.g, tint.r, 255,
+            tint.b, tint.g, tint.r, 255);
+
+        for (; i + 4 <= count; i += 4) 
+        {
+            __m128i s = _mm_loadu_si128((const __m128i*) (src + i));
+            __m128i d = _mm_loadu_si128((const __m128i*) (dst + i));
+
+            // Work on two pixels at a time as 16 bit channels
+            __m128i halves[2];
+            for (int h = 0; h < 2; h++) 
+            {
+                __m128i sc = h == 0 ? _mm_unpacklo_epi8(s, zero) : _mm_unpackhi_epi8(s, zero);
+                __m128i dc = h == 0 ? _mm_unpacklo_epi8(d, zero) : _mm_unpackhi_epi8(d, zero);
+
+                // Spread each pixel's alpha across its channels
+                __m128i a = _mm_shufflelo_epi16(sc, _MM_SHUFFLE(3, 3, 3, 3));
+                a = _mm_shufflehi_epi16(a, _MM_SHUFFLE(3, 3, 3, 3));
+
+                // Tint
+                __m128i t = _mm_add_epi16(_mm_mullo_epi16(sc, tintMul), half);
+                sc = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+
+                // Blend
+                __m128i v = _mm_add_epi16(
+                    _mm_mullo_epi16(sc, a),
+                    _mm_mullo_epi16(dc, _mm_sub_epi16(full, a)));
+                v = _mm_add_epi16(v, half);
+                halves[h] = _mm_srli_epi16(_mm_add_epi16(v, _mm_srli_epi16(v, 8)), 8);
+            }
+
+            _mm_storeu_si128((__m128i*) (dst + i), _mm_packus_epi16(halves[0], halves[1]));
+        }
+#endif
+
+        const Uint32 tints[4] = {tint.b, tint.g, tint.r, 255};
+        for (; i < count; i++) 
+        {
+            Uint32 s = src[i];
+            Uint32 d = dst[i];
+            Uint32 a = s >> 24;
+
+            Uint32 out = 0;
+            for (int c = 0; c < 4; c++) 
+            {
+                Uint32 sc = Div255(((s >> (c * 8)) & 0xFF) * tints[c]);
+                Uint32 dc = (d >> (c * 8)) & 0xFF;
+                out |= Div255(sc * a + dc * (255 - a)) << (c * 8);
+            }
+            dst[i] = out;
+        }
+    }
+};
+
+// Draws nothing, for headless runs. Textures only keep their size, which is
+// all the simulation needs from them.
+class NullRenderBackend : public RenderBackend
+{
+    public:
+    bool Init(SDL_Window* window, int inNativeWidth, int inNativeHeight, Uint32 renderFlags) override
+    {
+        nativeWidth = inNativeWidth;
+        nativeHeight = inNativeHeight;
+        return true;
+    }
+
+    void Quit() override {}
+
+    Texture* CreateTexture(SDL_Surface* surface) override
+    {
+        Texture* tex = new Texture();
+        tex->w = surface->w;
+        tex->h = surface->h;
+        return tex;
+    }
+
+    void DestroyTexture(Texture* tex) override
+    {
+        delete tex;
+    }
+
+    void BeginFrame() override {}
+    void DrawSprite(const Texture* tex, const SDL_Rect& dest, const SDL_Color& tint) override {}
+    void PresentFrame() override {}
+    bool ReadPixels(Uint32* pixels) override { return false; }
+};
+
+// Decodes images on a worker thread so a screen's sprites are ready before it's
+// shown. Only the file read and decode happen off the main thread, the textures
+// are still built on it since the renderer isn't thread safe.
+class AssetLoader
+{
+    public:
+    struct DecodedImage
+    {
+        std::string path;
+        SDL_Surface* surface;
+    };
+
+    AssetLoader():
+        inFlight(0),
+        running(false)
+    {}
+
+    void Init()
+    {
+        running.store(true);
+        worker = std::thread(&AssetLoader::WorkerLoop, this);
+    }
+
+    // Queue an image to decode, false if the queue is full
+    bool Request(const std::string& path)
+    {
+        if (!running.load() || !requests.Push(path)) return false;
+        inFlight++;
+        return true;
+    }
+
+    // A decoded RGBA32 surface, NULL if the file couldn't be read
+    bool PopDecoded(DecodedImage& image)
+    {
+        if (!decoded.Pop(image)) return false;
+        inFlight--;
+        return true;
+    }
+
+    bool IsIdle() const { return inFlight == 0; }
+
+    void Quit()
+    {
+        if (!running.load()) return;
+
+        running.store(false);
+        worker.join();
+
+        // Free anything decoded but never picked up
+        DecodedImage image;
+        while (PopDecoded(image)) SDL_FreeSurface(image.surface);
+    }
+
+    // Safe to call from any thread
+    static SDL_Surface* Decode(const char* filePath)
+    {
+        SDL_Surface* loaded = IMG_Load(filePath);
+        if (!loaded) 
+        {
+            LOG_ERROR("Error Loading the image: %s", SDL_GetError());
+            return NULL;
+        }
+
+        SDL_Surface* rgba = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+        SDL_FreeSurface(loaded);
+        if (!rgba) 
+        {
+            LOG_ERROR("Error converting the image: %s", SDL_GetError());
+            return NULL;
+        }
+
+        return rgba;
+    }
+
+    private:
+    SPSCQueue<std::string, 64> requests;
+    SPSCQueue<DecodedImage, 64> decoded;
+
+    // Only touched by the main thread
+    int inFlight;
+
+    std::atomic<bool> running;
+    std::thread worker;
+
+    void WorkerLoop()
+    {
+        while (running.load()) 
+        {
+            std::string path;
+            if (!requests.Pop(path)) 
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                continue;
+            }
+
+            DecodedImage image;
+            image.path = path;
+            image.surface = Decode(path.c_str());
+
+            // Requests are capped at the queue size, so this only waits if
+            // the main thread is slow to pick results up
+            while (!decoded.Push(image) && running.load()) 
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+        }
+    }
+};
+
+// A sprite recolored for every palette, built once at load
+struct PaletteTextures
+{
+    Texture* tex[paletteCount];
+    CollisionMask mask;
+    int w;
+    int h;
+};
+
+class SDL_General
+{
+public:
+    // The game is drawn at the art's native resolution, then upscaled
+    const int nativeWidth = 320;
+    const int nativeHeight = 240;
+    const int pixelScale = 3;
+    const int width = nativeWidth * pixelScale; 
+    const int height = nativeHeight * pixelScale;
+    const Vector2Int pos = Vector2Int();
+    SDL_Window* window;
+    RenderBackend* renderer;
+    vector<SDL_Event> events;
+    SoundMixer mixer;
+    ResourceTracker resources;
+    TimerWheel timers;
+    GameEventBus gameEvents;
+    AssetLoader loader;
+    int activePalette;
+
+    // No window, audio or text, just the simulation
+    bool headless;
+
+    SDL_General():
+        window(NULL),
+        renderer(NULL),
+        activePalette(0),
+        headless(false)
+    {}
+
+    // Sets up an engine that shares nothing with the rest of the process, so
+    // any number of them can run side by side on different threads
+    void InitHeadless()
+    {
+        headless = true;
+        renderer = new NullRenderBackend();
+        renderer->Init(NULL, nativeWidth, nativeHeight, 0);
+    }
+
+    void Init()
+    {   
+        // Init the SDL/Error catch
+        if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) != 0) 
+        { 
+            LOG_ERROR("Error with Init: %s", SDL_GetError()); 
+        }
+
+        if(TTF_Init() < 0) 
+        {
+            LOG_ERROR("Couldn't initialize TTF lib: %s", TTF_GetError());
+        }
+
+        // Open the audio device for the sound effects
+        mixer.Init();
+
+        // Start the background image decoder
+        loader.Init();
+
+        LOG_INFO("Init successful!!!");
+    }
+
+    void CreateWindow(
+        const char* title, 
+        const Uint32& flags) 
+    {
+        // Create the SDL window
+        window = SDL_CreateWindow(
+            title,
+            pos.x,
+            pos.y,
+            width,
+            height,
+            flags);
+
+        // Window Error Catch
+        if (window == NULL) 
+        {
+            SDL_Quit();
+            LOG_ERROR("Error Creating Window: %s", SDL_GetError());
+        }
+    }
+
+    void CreateRenderer(
+        const Uint32& renderFlags,
+        bool useSoftware = false)
+    {
+        // Error Catch
+        if (window == NULL) 
+        {
+            SDL_Quit();
+            LOG_ERROR("No Window defined to attach the renderer too");
+        }
+
+        // Pick the backend
+        if (useSoftware) renderer = new SoftwareRenderBackend();
+        else renderer = new SDLRenderBackend();
+
+        // Render Error Catch
+        if (!renderer->Init(window, nativeWidth, nativeHeight, renderFlags)) 
+        {
+            SDL_DestroyWindow(window);
+            SDL_Quit();
+            LOG_ERROR("Error Creating the renderer");
+        }
+    }
+
+    // Clear the native resolution frame
+    void BeginFrame()
+    {
+        renderer->BeginFrame();
+    }
+
+    // Upscale the frame to the window and present it
+    void PresentFrame()
+    {
+        renderer->PresentFrame();
+    }
+
+    Texture* CreateTexture(
+        SDL_Surface* surface,
+        const std::string& site)
+    {
+        Texture* tex = renderer->CreateTexture(surface);
+        if (tex != NULL) resources.TrackTexture(tex, tex->w, tex->h, site);
+        return tex;
+    }
+
+    Texture* CreateTextTexture(
+        TTF_Font* font,
+        const char* text,
+        SDL_Color color,
+        const char* site = "Text")
+    {
+        // Nothing is drawn headless, and SDL_ttf isn't thread safe
+        if (headless) return NULL;
+
+        if (window == NULL) 
+        {
+            SDL_Quit();
+            LOG_ERROR("No Window Defined");
+        }
+
+        if (renderer == NULL) 
+        {
+            SDL_DestroyWindow(window);
+            SDL_Quit();
+            LOG_ERROR("No Renderer Defined");
+        }
+
+        // Create the surface
+        SDL_Surface* surfaceMessage = TTF_RenderText_Solid(
+            font, 
+            text, 
+            color); 
+
+        // now you can convert it into a texture
+        Texture* textureMessage = CreateTexture(
+            surfaceMessage,
+            site);
+
+        // Disposing of the surface now that it's in grahpic memory
+        SDL_FreeSurface(surfaceMessage);  
+
+        // Return message texture
+        return textureMessage;
+    }
+
+    // Fonts are shared by everything using the same file and size
+    TTF_Font* GetFont(
+        const char* fontFile,
+        int size)
+    {
+        if (headless) return NULL;
+
+        std::string key = std::string(fontFile) + ":" + to_string(size);
+        std::map<std::string, TTF_Font*>::iterator cached = fontCache.find(key);
+        if (cached != fontCache.end()) return cached->second;
+
+        // This opens a font style and sets a size
+        TTF_Font* font = TTF_OpenFont(fontFile, size);
+        if (!font) 
+        {
+            LOG_ERROR("Error loading font: %s", TTF_GetError());
+            return NULL;
+        }
+
+        resources.TrackFont(font, key);
+        fontCache[key] = font;
+        return font;
+    }
+
+    void DestroyTexture(Texture* tex)
+    {
+        if (tex == NULL) return;
+
+        resources.Untrack(tex);
+        renderer->DestroyTexture(tex);
+    }
+
+    // Load a sprite as indexed color and build its texture for every palette.
+    // Results are cached per file so each sprite is only decoded once.
+    PaletteTextures* LoadPaletteTextures(
+        const char* filePath)
+    {
+        std::map<std::string, PaletteTextures>::iterator cached = paletteCache.find(filePath);
+        if (cached != paletteCache.end()) return &cached->second;
+
+        // Not preloaded, decode it here
+        SDL_Surface* rgba = AssetLoader::Decode(filePath);
+        if (!rgba) return NULL;
+
+        return BuildPaletteTextures(filePath, rgba);
+    }
+
+    // Start decoding sprites in the background, ahead of when they're needed
+    void PreloadSprites(const std::vector<std::string>& filePaths)
+    {
+        for (int i = 0; i < filePaths.size(); i++) 
+        {
+            const std::string& filePath = filePaths[i];
+            if (paletteCache.count(filePath) > 0 || preloadRequested.count(filePath) > 0) continue;
+
+            if (loader.Request(filePath)) preloadRequested[filePath] = true;
+        }
+    }
+
+    // Turn up to maxUploads decoded sprites into textures, called once a frame
+    void FinishPreloads(int maxUploads)
+    {
+        AssetLoader::DecodedImage image;
+        for (int i = 0; i < maxUploads && loader.PopDecoded(image); i++) 
+        {
+            preloadRequested.erase(image.path);
+
+            if (image.surface == NULL) continue;
+            if (paletteCache.count(image.path) > 0) 
+            {
+                SDL_FreeSurface(image.surface);
+                continue;
+            }
+
+            BuildPaletteTextures(image.path.c_str(), image.surface);
+        }
+    }
+
+    // Block until every requested sprite is a texture
+    void WaitForPreloads()
+    {
+        while (!loader.IsIdle()) 
+        {
+            FinishPreloads(INT32_MAX);
+            if (!loader.IsIdle()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    // Recolor an RGBA32 surface for every palette, takes ownership of it
+    PaletteTextures* BuildPaletteTextures(
+        const char* filePath,
+        SDL_Surface* rgba)
+    {
+        SDL_Surface* indexed = SDL_CreateRGBSurfaceWithFormat(
+            0, rgba->w, rgba->h, 8, SDL_PIXELFORMAT_INDEX8);
+
+        // Index 0 is kept for transparent pixels, everything else is solid
+        std::vector<SDL_Color> sourceColors;
+        CollisionMask mask;
+        mask.Resize(rgba->w, rgba->h);
+        SDL_LockSurface(rgba);
+        for (int row = 0; row < rgba->h; row++) 
+        {
+            const Uint8* src = (const Uint8*) rgba->pixels + row * rgba->pitch;
+            Uint8* dst = (Uint8*) indexed->pixels + row * indexed->pitch;
+
+            for (int col = 0; col < rgba->w; col++, src += 4) 
+            {
+                if (src[3] < 128) 
+                {
+                    dst[col] = 0;
+                    continue;
+                }
+
+                SDL_Color color = {src[0], src[1], src[2], 255};
+                dst[col] = (Uint8) (FindOrAddSourceColor(sourceColors, color) + 1);
+                mask.Set(col, row);
+            }
+        }
+        SDL_UnlockSurface(rgba);
+        SDL_FreeSurface(rgba);
+        SDL_SetColorKey(indexed, SDL_TRUE, 0);
+
+        // Rank the source colors by brightness so they map onto the shades
+        int colorCount = (int) sourceColors.size();
+        std::vector<int> shadeOf(colorCount, 0);
+        for (int i = 0; i < colorCount; i++) 
+        {
+            int rank = 0;
+            for (int j = 0; j < colorCount; j++) 
+            {
+                if (Luma(sourceColors[j]) < Luma(sourceColors[i]) ||
+                    (Luma(sourceColors[j]) == Luma(sourceColors[i]) && j < i)) rank++;
+            }
+            shadeOf[i] = rank * ColorPalette::shadeCount / colorCount;
+        }
+
+        // Build a texture for each palette
+        PaletteTextures& textures = paletteCache[filePath];
+        textures.w = indexed->w;
+        textures.h = indexed->h;
+        textures.mask = mask;
+
+        std::vector<SDL_Color> colors(colorCount + 1);
+        colors[0].r = colors[0].g = colors[0].b = colors[0].a = 0;
+        for (int p = 0; p < paletteCount; p++) 
+        {
+            for (int i = 0; i < colorCount; i++) 
+            {
+                colors[i + 1] = palettes[p].keepSourceColors ? 
+                    sourceColors[i] : palettes[p].shades[shadeOf[i]];
+            }
+            SDL_SetPaletteColors(indexed->format->palette, colors.data(), 0, colorCount + 1);
+
+            textures.tex[p] = CreateTexture(indexed, filePath);
+        }
+
+        SDL_FreeSurface(indexed);
+
+        return &textures;
+    }
+
+    void SetPalette(int palette)
+    {
+        if (palette < 0 || palette >= paletteCount) return;
+        activePalette = palette;
+    }
+
+    const ColorPalette& GetPalette() const { return palettes[activePalette]; }
+
+    void Quit() 
+    {
+        loader.Quit();
+
+        // Free the recolored sprites
+        std::map<std::string, PaletteTextures>::iterator it;
+        for (it = paletteCache.begin(); it != paletteCache.end(); it++) 
+        {
+            for (int p = 0; p < paletteCount; p++) DestroyTexture(it->second.tex[p]);
+        }
+        paletteCache.clear();
+
+        // Close the fonts
+        std::map<std::string, TTF_Font*>::iterator font;
+        for (font = fontCache.begin(); font != fontCache.end(); font++) 
+        {
+            resources.Untrack(font->second);
+            TTF_CloseFont(font->second);
+        }
+        fontCache.clear();
+
+        // Whatever is still tracked was never freed
+        if (!headless) resources.PrintStats();
+        resources.ReportLeaks();
+
+        // Quit the SDL
+        mixer.Quit();
+        if (renderer != NULL) 
+        {
+            renderer->Quit();
+            delete renderer;
+            renderer = NULL;
+        }
+
+        // SDL itself belongs to the windowed game
+        if (headless) return;
+
+        SDL_DestroyWindow(window);
+        SDL_Quit();
+    }
+
+    private:
+    std::map<std::string, PaletteTextures> paletteCache;
+    std::map<std::string, bool> preloadRequested;
+    std::map<std::string, TTF_Font*> fontCache;
+
+    static int Luma(const SDL_Color& color)
+    {
+        return color.r * 299 + color.g * 587 + color.b * 114;
+    }
+
+    static int FindOrAddSourceColor(std::vector<SDL_Color>& colors, const SDL_Color& color)
+    {
+        for (int i = 0; i < (int) colors.size(); i++) 
+        {
+            if (colors[i].r == color.r && colors[i].g == color.g && colors[i].b == color.b) return i;
+        }
+
+        // Room for 255 colors after the transparent index
+        if (colors.size() < 255) 
+        {
+            colors.push_back(color);
+            return (int) colors.size() - 1;
+        }
+
+        // Out of room, fall back to the closest color already in the table
+        int closest = 0;
+        int closestDist = INT32_MAX;
+        for (int i = 0; i < (int) colors.size(); i++) 
+        {
+            int dr = colors[i].r - color.r;
+            int dg = colors[i].g - color.g;
+            int db = colors[i].b - color.b;
+            int dist = dr * dr + dg * dg + db * db;
+            if (dist < closestDist) 
+            {
+                closestDist = dist;
+                closest = i;
+            }
+        }
+        return closest;
+    }
+};
+
+struct HighScoreEntry
+{
+    Sint32 score;
+    Uint32 timestamp;
+};
+
+// Persists the top scores to disk. Scores are handed to a background writer
+// thread through a lock-free queue so a save never stalls the game loop.
+//
+// File layout (host byte order):
+//   char   magic[4]  "G0HS"
+//   Uint16 version
+//   Uint16 count
+//   Uint32 checksum  CRC-32 of the entries
+//   HighScoreEntry   entries[count]
+class HighScoreStore
+{
+    public:
+    static const int maxEntries = 10;
+
+    HighScoreStore():
+        count(0),
+        running(false)
+    {}
+
+    void Init(const char* filePath)
+    {
+        path = filePath;
+
+        // Read the saved table, a missing file just means no scores yet
+        if (!Load()) count = 0;
+
+        // The writer thread keeps its own copy of the table
+        writerCount = count;
+        std::memcpy(writerTable, table, sizeof(table));
+
+        running.store(true);
+        writer = std::thread(&HighScoreStore::WriterLoop, this);
+    }
+
+    // Safe to call from the game loop, only pushes onto the queue
+    void Submit(int score)
+    {
+        Insert(table, count, score);
+
+        if (!pending.Push(score)) 
+        {
+            LOG_ERROR("High score queue full, dropping score: %d", score);
+        }
+    }
+
+    int GetCount() const { return count; }
+    const HighScoreEntry& GetEntry(int i) const { return table[i]; }
+    int GetBest() const { return count > 0 ? table[0].score : 0; }
+
+    void Quit()
+    {
+        if (!running.load()) return;
+
+        // The writer drains whatever is still queued before exiting
+        running.store(false);
+        writer.join();
+    }
+
+    private:
+    struct FileHeader
+    {
+        char magic[4];
+        Uint16 version;
+        Uint16 count;
+        Uint32 checksum;
+    };
+
+    static const Uint16 fileVersion = 1;
+
+    std::string path;
+    HighScoreEntry table[maxEntries];
+    int count;
+
+    // Only touched by the writer thread
+    HighScoreEntry writerTable[maxEntries];
+    int writerCount;
+
+    SPSCQueue<int, 64> pending;
+    std::atomic<bool> running;
+    std::thread writer;
+
+    static Uint32 Checksum(const void* data, size_t size)
+    {
+        const Uint8* bytes = (const Uint8*) data;
+        Uint32 crc = 0xFFFFFFFF;
+
+        for (size_t i = 0; i < size; i++) 
+        {
+            crc ^= bytes[i];
+            for (int bit = 0; bit < 8; bit++) 
+            {
+                crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+            }
+        }
+
+        return ~crc;
+    }
+
+    static void Insert(HighScoreEntry* entries, int& entryCount, int score)
+    {
+        // Find where the score ranks
+        int rank = entryCount;
+        while (rank > 0 && entries[rank - 1].score < score) rank--;
+        if (rank >= maxEntries) return;
+
+        // Shift the lower scores down a slot
+        int last = entryCount < maxEntries ? entryCount : maxEntries - 1;
+        for (int i = last; i > rank; i--) entries[i] = entries[i - 1];
+
+        entries[rank].score = score;
+        entries[rank].timestamp = (Uint32) std::time(NULL);
+        if (entryCount < maxEntries) entryCount++;
+    }
+
+    bool Parse(const Uint8* data, size_t size)
+    {
+        if (size < sizeof(FileHeader)) return false;
+
+        FileHeader header;
+        std::memcpy(&header, data, sizeof(header));
+
+        if (std::memcmp(header.magic, "G0HS", 4) != 0 || header.version != fileVersion) 
+        {
+            LOG_ERROR("High score file has an unknown format: %s", path.c_str());
+            return false;
+        }
+
+        size_t entryBytes = header.count * sizeof(HighScoreEntry);
+        if (header.count > maxEntries || size < sizeof(header) + entryBytes) return false;
+
+        if (Checksum(data + sizeof(header), entryBytes) != header.checksum) 
+        {
+            LOG_ERROR("High score file is corrupt: %s", path.c_str());
+            return false;
+        }
+
+        std::memcpy(table, data + sizeof(header), entryBytes);
+        count = header.count;
+        return true;
+    }
+
+    bool Load()
+    {
+#ifndef _WIN32
+        // Map the whole file and parse it in place
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0) 
+        {
+            close(fd);
+            return false;
+        }
+
+        void* data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) return false;
+
+        bool loaded = Parse((const Uint8*) data, info.st_size);
+        munmap(data, info.st_size);
+        return loaded;
+#else
+        // No mmap here, fall back to one read of the whole file
+        FILE* file = std::fopen(path.c_str(), "rb");
+        if (!file) return false;
+
+        Uint8 data[sizeof(FileHeader) + sizeof(table)];
+        size_t size = std::fread(data, 1, sizeof(data), file);
+        std::fclose(file);
+        return Parse(data, size);
+#endif
+    }
+
+    bool Save()
+    {
+        FileHeader header;
+        std::memcpy(header.magic, "G0HS", 4);
+        header.version = fileVersion;
+        header.count = (Uint16) writerCount;
+        header.checksum = Checksum(writerTable, writerCount * sizeof(HighScoreEntry));
+
+        // Write the new table next to the old one
+        std::string tempPath = path + ".tmp";
+        FILE* file = std::fopen(tempPath.c_str(), "wb");
+        if (!file) 
+        {
+            LOG_ERROR("Error opening high score file: %s", tempPath.c_str());
+            return false;
+        }
+
+        bool written = 
+            std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+            std::fwrite(writerTable, sizeof(HighScoreEntry), writerCount, file) == (size_t) writerCount &&
+            std::fflush(file) == 0;
+#ifndef _WIN32
+        // Make sure the data is on disk before it replaces the old file
+        written = written && fsync(fileno(file)) == 0;
+#endif
+        std::fclose(file);
+
+        if (!written) 
+        {
+            LOG_ERROR("Error writing high score file: %s", tempPath.c_str());
+            std::remove(tempPath.c_str());
+            return false;
+        }
+
+        // Swap it in, a crash leaves either the old or the new file intact.
+        // Windows' rename won't replace an existing file, MoveFileEx does it in one step
+#ifdef _WIN32
+        bool replaced = MoveFileExA(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+        bool replaced = std::rename(tempPath.c_str(), path.c_str()) == 0;
+#endif
+        if (!replaced) 
+        {
+            LOG_ERROR("Error replacing high score file: %s", path.c_str());
+            return false;
+        }
+
+        return true;
+    }
+
+    void WriterLoop()
+    {
+        while (true) 
+        {
+            // Read the flag first so nothing pushed before Quit() is missed
+            bool keepRunning = running.load();
+
+            int score;
+            bool changed = false;
+            while (pending.Pop(score)) 
+            {
+                Insert(writerTable, writerCount, score);
+                changed = true;
+            }
+
+            if (changed) Save();
+            if (!keepRunning) return;
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    }
+};
+
+// Saves frames to disk without holding up the game loop. Frames are read back
+// into a fixed pool of buffers and handed to a writer thread over lock-free
+// queues. Screenshots are written as PNG, recordings as raw ARGB8888 frames
+// (ffmpeg -f rawvideo -pixel_format bgra -video_size 320x240 -i file). If the
+// writer falls behind and every buffer is in use the frame is dropped.
+class FrameCapture
+{
+    public:
+    static const int poolSize = 8;
+
+    FrameCapture():
+        width(0),
+        height(0),
+        recording(false),
+        screenshotRequested(false),
+        session(0),
+        frameCount(0),
+        heldBuffer(-1),
+        running(false),
+        dropped(0),
+        written(0)
+    {}
+
+    void Init(int inWidth, int inHeight)
+    {
+        width = inWidth;
+        height = inHeight;
+
+        // Every buffer starts out free
+        for (int i = 0; i < poolSize; i++) 
+        {
+            pool[i].pixels.resize(width * height);
+            freeBuffers.Push(i);
+        }
+
+        running.store(true);
+        writer = std::thread(&FrameCapture::WriterLoop, this);
+    }
+
+    // The next captured frame is saved as a PNG
+    void RequestScreenshot() { screenshotRequested = true; }
+
+    void ToggleRecording()
+    {
+        recording = !recording;
+        if (recording) session++;
+
+        LOG_INFO(recording ? "Recording started" : "Recording stopped");
+    }
+
+    bool IsRecording() const { return recording; }
+
+    // Call after drawing and before presenting
+    void Capture(RenderBackend* renderer)
+    {
+        if (!recording && !screenshotRequested) return;
+
+        // The writer is the only producer on freeBuffers, so a buffer that failed to read is kept here
+        int index = heldBuffer;
+        if (index < 0 && !freeBuffers.Pop(index)) 
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        heldBuffer = -1;
+
+        CapturedFrame& frame = pool[index];
+        if (!renderer->ReadPixels(frame.pixels.data())) 
+        {
+            heldBuffer = index;
+            return;
+        }
+
+        frame.screenshot = screenshotRequested;
+        frame.recorded = recording;
+        frame.session = session;
+        frame.number = frameCount++;
+        screenshotRequested = false;
+
+        filledBuffers.Push(index);
+    }
+
+    void PrintStats() const
+    {
+        std::cout << "Frame capture: " 
+                  << written.load() << " written, " 
+                  << dropped.load() << " dropped" 
+                  << std::endl;
+    }
+
+    void Quit()
+    {
+        if (!running.load()) return;
+
+        // The writer drains whatever is still queued before exiting
+        running.store(false);
+        writer.join();
+    }
+
+    private:
+    struct CapturedFrame
+    {
+        std::vector<Uint32> pixels;
+        bool screenshot;
+        bool recorded;
+        int session;
+        Uint32 number;
+    };
+
+    int width;
+    int height;
+    CapturedFrame pool[poolSize];
+
+    // Only touched by the game thread
+    bool recording;
+    bool screenshotRequested;
+    int session;
+    Uint32 frameCount;
+    int heldBuffer;
+
+    // Buffer indices, game thread to writer and back again
+    SPSCQueue<int, poolSize> filledBuffers;
+    SPSCQueue<int, poolSize> freeBuffers;
+
+    std::atomic<bool> running;
+    std::atomic<int> dropped;
+    std::atomic<int> written;
+    std::thread writer;
+
+    void SavePNG(const CapturedFrame& frame)
+    {
+        char fileName[64];
+        std::snprintf(fileName, sizeof(fileName), "screenshot-%ld-%u.png", (long) std::time(NULL), frame.number);
+
+        SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom(
+            (void*) frame.pixels.data(), width, height, 32,
+            width * sizeof(Uint32), SDL_PIXELFORMAT_ARGB8888);
+
+        if (!surface || IMG_SavePNG(surface, fileName) != 0) 
+        {
+            LOG_ERROR("Error saving screenshot: %s", SDL_GetError());
+        }
+        else 
+        {
+            LOG_INFO("Saved %s", fileName);
+        }
+        SDL_FreeSurface(surface);
+    }
+
+    void WriterLoop()
+    {
+        FILE* video = NULL;
+        int videoSession = 0;
+
+        while (true) 
+        {
+            // Read the flag first so nothing captured before Quit() is missed
+            bool keepRunning = running.load();
+
+            int index;
+            while (filledBuffers.Pop(index)) 
+            {
+                const CapturedFrame& frame = pool[index];
+
+                if (frame.screenshot) SavePNG(frame);
+
+                if (frame.recorded) 
+                {
+                    // Each recording goes into its own file
+                    if (video == NULL || frame.session != videoSession) 
+                    {
+                        if (video != NULL) std::fclose(video);
+
+                        char fileName[64];
+                        std::snprintf(fileName, sizeof(fileName), "capture-%ld-%d.raw", (long) std::time(NULL), frame.session);
+                        video = std::fopen(fileName, "wb");
+                        videoSession = frame.session;
+
+                        if (video == NULL) LOG_ERROR("Error opening capture file: %s", fileName);
+                    }
+
+                    if (video != NULL) 
+                    {
+                        std::fwrite(frame.pixels.data(), sizeof(Uint32), frame.pixels.size(), video);
+                    }
+                }
+
+                written.fetch_add(1, std::memory_order_relaxed);
+                freeBuffers.Push(index);
+            }
+
+            if (!keepRunning) break;
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+
+        if (video != NULL) std::fclose(video);
+    }
+};
+// -----------------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+// Objects
+
+class GameObject;
+
+// The whole simulation state packed into one flat buffer. The buffer keeps its
+// memory between saves, so snapshots are cheap enough to take every frame.
+// Pointers between objects are saved as ids and patched up after loading.
+class Snapshot
+{
+    public:
+    std::vector<Uint8> data;
+
+    Snapshot():
+        readPos(0),
+        failed(false)
+    {}
+
+    void BeginWrite()
+    {
+        data.clear();
+        failed = false;
+    }
+
+    void BeginRead()
+    {
+        readPos = 0;
+        failed = false;
+        loadedObjects.clear();
+        refFixups.clear();
+    }
+
+    template <typename T>
+    void Write(const T& value)
+    {
+        size_t size = data.size();
+        data.resize(size + sizeof(T));
+        std::memcpy(&data[size], &value, sizeof(T));
+    }
+
+    template <typename T>
+    void Read(T& value)
+    {
+        if (failed || readPos + sizeof(T) > data.size()) 
+        {
+            failed = true;
+            value = T();
+            return;
+        }
+
+        std::memcpy(&value, &data[readPos], sizeof(T));
+        readPos += sizeof(T);
+    }
+
+    void WriteString(const std::string& value)
+    {
+        Write((Uint16) value.size());
+        data.insert(data.end(), value.begin(), value.end());
+    }
+
+    void ReadString(std::string& value)
+    {
+        Uint16 size;
+        Read(size);
+        if (failed || readPos + size > data.size()) 
+        {
+            failed = true;
+            value.clear();
+            return;
+        }
+
+        value.assign((const char*) &data[readPos], size);
+        readPos += size;
+    }
+
+    // Objects that others can point at are numbered in load order
+    void AddLoadedObject(const GameObject* object) { loadedObjects.push_back(object); }
+
+    // Fill in the pointer once everything has been loaded
+    void ReadRef(const GameObject** slot)
+    {
+        int id;
+        Read(id);
+        *slot = NULL;
+        if (id >= 0) refFixups.push_back(std::make_pair(slot, id));
+    }
+
+    void ResolveRefs()
+    {
+        for (int i = 0; i < refFixups.size(); i++) 
+        {
+            int id = refFixups[i].second;
+            *refFixups[i].first = id < loadedObjects.size() ? loadedObjects[id] : NULL;
+        }
+        refFixups.clear();
+    }
+
+    bool Failed() const { return failed; }
+
+    // Two snapshots of deterministic runs at the same tick should match
+    bool Matches(const Snapshot& other) const { return data == other.data; }
+
+    private:
+    size_t readPos;
+    bool failed;
+    std::vector<const GameObject*> loadedObjects;
+    std::vector<std::pair<const GameObject**, int> > refFixups;
+};
+
+class Scene
+{
+    public:
+    Frame mainFrame;
+    Frame killLogFrame;
+    Grid mainGrid;
+    Grid killLogGrid;
+    std::vector<std::vector<GameObject*>> killLogList;
+    Random rng;
+    const char* fontFile = "resources/Born2bSportyV2.ttf";
+    const int fontSize = 11;
+
+    // Layout is in native resolution pixels
+    Scene()
+    {
+        mainFrame.origin = Vector2Int(3, 3);
+        mainFrame.size = Vector2Int(240, 235);
+
+        mainGrid.dim = Vector2Int(8, 6);
+        mainGrid.elemSize = Vector2Int(30, 30);
+        mainGrid.MakeColPosArray();
+        mainGrid.MakeRowPosArray();
+
+        killLogFrame.origin = Vector2Int(250, 5);
+        killLogFrame.size = Vector2Int(69, 163);
+
+        killLogGrid.origin = killLogFrame.origin;
+        killLogGrid.dim = Vector2Int(1, 10);
+        killLogGrid.elemSize = Vector2Int(65, 16);
+        killLogGrid.MakeColPosArray();
+        killLogGrid.MakeRowPosArray();
+    }
+
+    void AppendKillLog(GameObject* logName, GameObject* logValue);
+};
+
+class GameObject : public SDL_Rect
+{
+    public:
+    enum Type
+    {
+        ENEMY,
+        PROJECTILE,
+        PLAYER,
+        ROOT,
+        DEFAULT
+    };
+
+    std::string name;
+    Type type = Type::DEFAULT;
+    Texture* tex;
+    SDL_General* SDL_Gen;
+    Scene* scene;
+    GameObject* root;
+    std::vector<GameObject*> children;
+    int snapshotId = -1;
+
+    GameObject(const Vector2Int& inPos = Vector2Int(0, 0),
+               SDL_General* SDL_GenPtr = NULL,
+               Scene* scenePtr = NULL,
+               GameObject* rootPtr = NULL) :
+        tex(NULL),
+        children()
+    {
+        // Set the position of the game object
+        x = inPos.x;
+        y = inPos.y;
+
+        // Set the SDL General pointer
+        SDL_Gen = SDL_GenPtr;
+
+        // Set the pointer to the scene object
+        scene = scenePtr;
+
+        // Set the root pointer
+        root = rootPtr;
+
+        if (SDL_Gen != NULL) SDL_Gen->resources.TrackObject(this, &name);
+    }
+
+    GameObject(const GameObject& other) :
+        SDL_Rect(other),
+        name(other.name),
+        type(other.type),
+        tex(other.tex),
+        SDL_Gen(other.SDL_Gen),
+        scene(other.scene),
+        root(other.root),
+        children(other.children),
+        snapshotId(other.snapshotId),
+        spawnedFrom(other.spawnedFrom != NULL ? other.spawnedFrom : &other),
+        destroyQueued(other.destroyQueued)
+    {
+        if (SDL_Gen != NULL) SDL_Gen->resources.CountCopy(spawnedFrom, 1);
+    }
+
+    virtual ~GameObject()
+    {
+        if (SDL_Gen == NULL) return;
+
+        if (spawnedFrom != NULL) SDL_Gen->resources.CountCopy(spawnedFrom, -1);
+        else SDL_Gen->resources.Untrack(this);
+    }
+
+    virtual void Process(const float& deltaTime) {}
+
+    // Called on a copy of a prefab once it's placed in the scene
+    virtual void OnSpawn() {}
+
+    // The texture to draw with the active palette
+    virtual Texture* GetTexture() { return tex; }
+
+    // Solid pixels for pixel-perfect collisions, NULL if the whole rect is solid
+    virtual const CollisionMask* GetCollisionMask() const { return NULL; }
+
+    // Color multiplied into the texture when drawing
+    virtual SDL_Color GetTint()
+    {
+        SDL_Color white = {255, 255, 255, 255};
+        return white;
+    }
+
+    // Save and restore this object's part of the simulation state
+    virtual void SaveState(Snapshot& snap) {}
+    virtual void LoadState(Snapshot& snap) {}
+
+    virtual void Destroy() 
+    {
+        // Children go down with their parent
+        DestroyChildren();
+        delete this;
+    }
+
+    void DestroyChildren()
+    {
+        for (int i = 0; i < children.size(); i++) children[i]->Destroy();
+        children.clear();
+    }
+
+    bool GetDestroyQueuedVal() const { return destroyQueued; }
+    void SetDestroyQueuedVal(bool inVal) 
+    { 
+        destroyQueued = inVal; 
+    }
+
+    protected: 
+    // The prototype this was copied from, it's tracked on that one's record
+    const GameObject* spawnedFrom = NULL;
+    bool destroyQueued = false;
+};
+
+void Scene::AppendKillLog(GameObject* logName, GameObject* logValue)
+{
+    // Kill Log entry
+    std::vector<GameObject*> killLogEntry;
+    killLogEntry.push_back(logValue);
+    killLogEntry.push_back(logName);
+
+    // Drop the oldest entry once the log is full
+    if (killLogList.size() >= killLogGrid.dim.y)
+    {
+        killLogList[0][0]->SetDestroyQueuedVal(true);
+        killLogList[0][1]->SetDestroyQueuedVal(true);
+        killLogList.erase(killLogList.begin());
+    }
+
+    // Shift the older entries up a row, the newest sits on the bottom row
+    for (int i = 0; i < killLogList.size(); i++)
+    {
+        int row = killLogGrid.rowPos.size() - 1 - (killLogList.size() - i);
+        killLogList[i][0]->y = killLogGrid.rowPos[row];
+        killLogList[i][1]->y = killLogGrid.rowPos[row];
+    }
+    
+    killLogList.push_back(killLogEntry);
+}
+
+class TextObject : public GameObject
+{
+    public:
+    enum HorzAlign
+    {
+        LEFT,
+        CENTER,
+        RIGHT
+    };
+
+    TTF_Font* font;
+    HorzAlign horzAlign;
+    ColorPalette::TextColor color;
+    Vector2Int pos;
+
+    TextObject(const Vector2Int& inPos = Vector2Int(0, 0),
+          SDL_General* SDL_GenPtr = NULL,
+          Scene* scenePtr = NULL,
+          GameObject* rootPtr = NULL,
+          const char* message = NULL,
+          const char* fontFile = NULL,
+          int size = 24,
+          ColorPalette::TextColor inColor = ColorPalette::TEXT,
+          HorzAlign inHorzAlign = HorzAlign::LEFT)
+        : GameObject(inPos, SDL_GenPtr, scenePtr, rootPtr)
+    {
+        // If no message passed in
+        if (message == NULL) LOG_ERROR("No message given for text object!");
+
+        // Get the font, opened once and shared
+        font = SDL_Gen->GetFont(fontFile, size);
+
+        // Set the color
+        color = inColor;
+
+        // Log the pos
+        pos = inPos;
+
+        // Get the text as a SDL Texture
+        tex = SDL_Gen->CreateTextTexture(
+            font,
+            message,
+            White(),
+            "TextObject");
+
+        // Get the dimensions of the sprite image
+        if (tex != NULL) 
+        {
+            w = tex->w;
+            h = tex->h;
+        }
+
+        // Check alignment
+        horzAlign = inHorzAlign;
+        AdjustToHorzAlignment();
+    }
+
+    ~TextObject()
+    {
+        // The text texture belongs to this object
+        SDL_Gen->DestroyTexture(tex);
+    }
+
+    SDL_Color GetTint() override
+    {
+        return SDL_Gen->GetPalette().textColors[color];
+    }
+    
+    protected:
+    // Text is rasterized white and tinted at draw time
+    static SDL_Color White()
+    {
+        SDL_Color white = {255, 255, 255, 255};
+        return white;
+    }
+
+    void AdjustToHorzAlignment()
+    {
+        switch(horzAlign) 
+        {
+            case HorzAlign::RIGHT:
+                x = pos.x - w;
+                break;
+            case HorzAlign::CENTER:
+                x = pos.x - w / 2;
+                break;
+            default:
+                break;
+        }
+    }
+
+    private:
+};
+
+class ScoreText : public TextObject, public GameEventListener
+{
+    public:
+    int value = 0;
+
+    ScoreText(const Vector2Int& inPos = Vector2Int(0, 0),
+          SDL_General* SDL_GenPtr = NULL,
+          Scene* scenePtr = NULL,
+          GameObject* rootPtr = NULL,
+          const char* message = NULL,
+          const char* fontFile = NULL,
+          int size = 24,
+          ColorPalette::TextColor color = ColorPalette::TEXT,
+          HorzAlign inHorzAlign = HorzAlign::LEFT)
+        : TextObject(inPos, SDL_GenPtr, scenePtr, rootPtr, message, fontFile, size, color, inHorzAlign)
+    {}
+
+    void UpdateValue(const int& inValue)
+    {
+        value += inValue;
+
+        // Swap in the new text texture
+        SDL_Gen->DestroyTexture(tex);
+        tex = SDL_Gen->CreateTextTexture(
+            font,
+            to_string(value).c_str(),
+            White(),
+            "ScoreText");
+
+        // Get the dimensions of the sprite image
+        if (tex != NULL) 
+        {
+            w = tex->w;
+            h = tex->h;
+        }
+
+        // Set the alignment
+        AdjustToHorzAlignment();
+    }
+
+    // Add up every kill this frame so the text is only redrawn once
+    void OnGameEvents(const GameEvent* events, int count) override
+    {
+        int points = 0;
+        for (int i = 0; i < count; i++) 
+        {
+            if (events[i].type == GameEvent::ENEMY_KILLED) points += events[i].value;
+        }
+
+        if (points == 0) return;
+
+        UpdateValue(points);
+        SDL_Gen->gameEvents.Push(GameEvent::Make(GameEvent::SCORE_CHANGED, value));
+    }
+
+    void SaveState(Snapshot& snap) override
+    {
+        snap.Write(value);
+    }
+
+    void LoadState(Snapshot& snap) override
+    {
+        int savedValue;
+        snap.Read(savedValue);
+        if (savedValue == value) return;
+
+        // Only redraw the text if the score is different
+        value = savedValue;
+        UpdateValue(0);
+    }
+
+    private:
+};
+
+// Shows the recent kills. All kills of the same enemy in one frame share an
+// entry, so a burst of kills only adds one line.
+class KillLog : public GameObject, public GameEventListener
+{
+    public:
+    KillLog(const Vector2Int& inPos = Vector2Int(0, 0),
+            SDL_General* SDL_GenPtr = NULL,
+            Scene* scenePtr = NULL,
+            GameObject* rootPtr = NULL)
+        : GameObject(inPos, SDL_GenPtr, scenePtr, rootPtr)
+    {}
+
+    ~KillLog()
+    {
+        // Free the entries still on screen
+        scene->killLogList.clear();
+        DestroyChildren();
+    }
+
+    void SaveState(Snapshot& snap) override
+    {
+        snap.Write((int) entries.size());
+        for (int i = 0; i < entries.size(); i++) 
+        {
+            snap.WriteString(entries[i].first);
+            snap.Write(entries[i].second);
+        }
+    }
+
+    void LoadState(Snapshot& snap) override
+    {
+        int count;
+        snap.Read(count);
+
+        std::vector<std::pair<std::string, int> > saved(std::max(count, 0));
+        for (int i = 0; i < saved.size(); i++) 
+        {
+            snap.ReadString(saved[i].first);
+            snap.Read(saved[i].second);
+        }
+
+        // Only rebuild the text if the log is different
+        if (saved == entries) return;
+
+        scene->killLogList.clear();
+        DestroyChildren();
+        entries.clear();
+        for (int i = 0; i < saved.size(); i++) AddEntry(saved[i].first, saved[i].second);
+    }
+
+    void OnGameEvents(const GameEvent* events, int count) override
+    {
+        std::vector<bool> handled(count, false);
+
+        for (int i = 0; i < count; i++) 
+        {
+            if (handled[i] || events[i].type != GameEvent::ENEMY_KILLED) continue;
+
+            // Gather the kills of this enemy
+            int kills = 0;
+            int points = 0;
+            for (int j = i; j < count; j++) 
+            {
+                if (events[j].type != GameEvent::ENEMY_KILLED) continue;
+                if (std::strcmp(events[j].name, events[i].name) != 0) continue;
+
+                kills++;
+                points += events[j].value;
+                handled[j] = true;
+            }
+
+            std::string logText = events[i].name;
+            if (kills > 1) logText += " x" + to_string(kills);
+
+            AddEntry(logText, points);
+        }
+    }
+
+    private:
+    // Text of each entry on screen, oldest first
+    std::vector<std::pair<std::string, int> > entries;
+
+    void AddEntry(const std::string& logText, int points)
+    {
+        // Keep the text in step with the scene's log
+        if (entries.size() >= scene->killLogGrid.dim.y) entries.erase(entries.begin());
+        entries.push_back(std::make_pair(logText, points));
+
+        // Update the hill log
+        ColorPalette::TextColor color = ColorPalette::KILL_LOG;
+
+        TextObject* logName = new TextObject(
+            Vector2Int(
+                scene->killLogGrid.colPos[0], 
+                scene->killLogGrid.rowPos[scene->killLogGrid.rowPos.size() - 1]),
+            SDL_Gen,
+            scene,
+            root,
+            logText.c_str(),
+            scene->fontFile,
+            scene->fontSize,
+            color);
+        logName->name = "Kill-Log-Name";
+        children.push_back(logName);
+
+        std::string valMod = "+";
+
+        TextObject* logValue = new TextObject(
+            Vector2Int(
+                scene->killLogGrid.origin.x + scene->killLogGrid.elemSize.x, 
+                scene->killLogGrid.rowPos[scene->killLogGrid.rowPos.size() - 1]),
+            SDL_Gen,
+            scene,
+            root,
+            (valMod + to_string(points)).c_str(),
+            scene->fontFile,
+            scene->fontSize,
+            color,
+            TextObject::HorzAlign::RIGHT);
+        logValue->name = "Kill-Log-Value";
+        children.push_back(logValue);
+
+        scene->AppendKillLog(logName, logValue);
+    }
+};
+
+class SpriteObject : public GameObject
+{
+    public:
+    PaletteTextures* paletteTex;
+
+    SpriteObject(const Vector2Int& inPos = Vector2Int(0, 0),
+          SDL_General* SDL_GenPtr = NULL,
+          Scene* scenePtr = NULL,
+          GameObject* rootPtr = NULL,
+          const char* spriteFile = NULL)
+        : GameObject(inPos, SDL_GenPtr, scenePtr, rootPtr),
+          paletteTex(NULL)
+    {
+        // Set the game object's sprite
+        if (spriteFile != NULL) {
+            if (SDL_Gen == NULL) LOG_ERROR("SDL Gen is NULL");
+
+            // Get the recolored textures, shared by every sprite using the file
+            paletteTex = SDL_Gen->LoadPaletteTextures(spriteFile);
+            if (paletteTex == NULL) return;
+
+            tex = paletteTex->tex[SDL_Gen->activePalette];
+            w = paletteTex->w;
+            h = paletteTex->h;
+        }
+    }
+
+    // Switching palettes is just picking another prebuilt texture
+    Texture* GetTexture() override
+    {
+        if (paletteTex == NULL) return tex;
+        return paletteTex->tex[SDL_Gen->activePalette];
+    }
+
+    // The mask only lines up while the sprite is drawn at its own size
+    const CollisionMask* GetCollisionMask() const override
+    {
+        if (paletteTex == NULL || paletteTex->mask.Empty()) return NULL;
+        if (w != paletteTex->mask.w || h != paletteTex->mask.h) return NULL;
+        return &paletteTex->mask;
+    }
+
+    private:
+};
+
+// Narrow phase once the rects are known to touch, with a placed at (ax, ay)
+bool PixelsOverlap(const GameObject* a, int ax, int ay, const GameObject* b)
+{
+    const CollisionMask* maskA = a->GetCollisionMask();
+    const CollisionMask* maskB = b->GetCollisionMask();
+    if (maskA == NULL || maskB == NULL) return true;
+
+    return maskA->Overlaps(*maskB, b->x - ax, b->y - ay);
+}
+
+// A named, fully built object to stamp copies from. The prototype does the
+// texture lookup and setup once at load, spawning is a copy into the pool.
+// T needs a public `ObjectPool<T>* pool` so its copies can release themselves.
+template<typename T>
+class Prefab
+{
+    public:
+    T prototype;
+    ObjectPool<T> pool;
+
+    Prefab(const char* inName,
+           SDL_General* SDL_GenPtr,
+           Scene* scenePtr,
+           GameObject* rootPtr,
+           const char* spriteFile)
+        : prototype(Vector2Int(0, 0), SDL_GenPtr, scenePtr, rootPtr, spriteFile)
+    {
+        prototype.name = inName;
+        prototype.pool = &pool;
+    }
+
+    T* Spawn(const Vector2Int& inPos)
+    {
+        T* object = pool.Create(prototype);
+        object->x = inPos.x;
+        object->y = inPos.y;
+        object->OnSpawn();
+        return object;
+    }
+};
+
+class Laser : public SpriteObject {
+    public:
+    Laser(const Vector2Int& inPos = Vector2Int(0, 0),
+          SDL_General* SDL_GenPtr = NULL,
+          Scene* scenePtr = NULL,
+          GameObject* rootPtr = NULL,
+          const char* spriteFile = NULL)
+        : SpriteObject(inPos, SDL_GenPtr, scenePtr, rootPtr, spriteFile)
+    {
+        type = Type::PROJECTILE;
+    }
+
+    ~Laser()
+    {
+        SDL_Gen->timers.Cancel(lifetime);
+    }
+
+    ObjectPool<Laser>* pool = NULL;
+
+    void OnSpawn() override
+    {
+        pos.x = (float) x;
+        pos.y = (float) y;
+        prevPos = pos;
+
+        // Despawn once the laser has been up for its max time
+        lifetime = SDL_Gen->timers.Schedule(
+            maxTime,
+            [this]() { SetDestroyQueuedVal(true); });
+    }
+
+    // Hand the slot back to the laser prefab
+    void Destroy() override
+    {
+        DestroyChildren();
+        pool->Release(this);
+    }
+
+    void Process(const float& deltaTime) override
+    {
+        // Another laser finished off the target first, keep flying
+        ForgetDeadTarget();
+
+        // The enemy hit on the last move has taken the damage by now
+        if (spent || hitTarget != NULL) 
+        {
+            SetDestroyQueuedVal(true);
+            return;
+        }
+
+        // Update the position
+        prevPos = pos;
+        pos.y -= speed * deltaTime;
+
+        // Set the position of the dest
+        y = (int) pos.y;
+
+        // Check the whole move for enemies so fast lasers can't skip past one
+        float firstImpact = 1.0f;
+        FindHitTarget(root, firstImpact);
+    }
+
+    // Whether this laser hit the given object on its last move, a laser only
+    // ever hits once
+    bool Hits(const GameObject* node)
+    {
+        if (spent) return false;
+
+        // The sweep already picked the earliest impact, only fall back to the
+        // overlap test when it found nothing
+        bool hit = hitTarget != NULL ? node == hitTarget :
+                   SDL_HasIntersection(this, node) && PixelsOverlap(this, x, y, node);
+        if (hit) 
+        {
+            spent = true;
+            hitTarget = NULL;
+        }
+
+        return hit;
+    }
+
+    void SaveState(Snapshot& snap) override
+    {
+        ForgetDeadTarget();
+
+        snap.Write(pos);
+        snap.Write(prevPos);
+        snap.Write(SDL_Gen->timers.Remaining(lifetime));
+        snap.Write(hitTarget != NULL ? hitTarget->snapshotId : -1);
+        snap.Write(spent);
+    }
+
+    void LoadState(Snapshot& snap) override
+    {
+        snap.Read(pos);
+        snap.Read(prevPos);
+        x = (int) pos.x;
+        y = (int) pos.y;
+
+        Uint32 timeLeft;
+        snap.Read(timeLeft);
+        SDL_Gen->timers.Cancel(lifetime);
+        lifetime = SDL_Gen->timers.Schedule(
+            timeLeft,
+            [this]() { SetDestroyQueuedVal(true); });
+
+        snap.ReadRef(&hitTarget);
+        snap.Read(spent);
+    }
+
+    private:
+    Vector2 pos;
+    Vector2 prevPos;
+    float speed = 200;
+    Uint32 maxTime = 2000;
+    TimerWheel::Handle lifetime;
+    const GameObject* hitTarget = NULL;
+    bool spent = false;
+
+    // A destroyed enemy's slot goes back to its pool and can be handed to a new one
+    void ForgetDeadTarget()
+    {
+        if (hitTarget != NULL && hitTarget->GetDestroyQueuedVal()) hitTarget = NULL;
+    }
+
+    // Walk the move a pixel at a time from where the rects first touch until
+    // the sprites' solid pixels meet
+    bool FirstPixelContact(const GameObject* node, float& impact) const
+    {
+        float dx = pos.x - prevPos.x;
+        float dy = pos.y - prevPos.y;
+        int steps = (int) std::ceil(std::max(std::fabs(dx), std::fabs(dy)) * (1.0f - impact)) + 1;
+
+        for (int i = 0; i < steps; i++) 
+        {
+            float t = i + 1 == steps ? 1.0f : impact + (1.0f - impact) * i / (steps - 1);
+            int stepX = (int) (prevPos.x + dx * t);
+            int stepY = (int) (prevPos.y + dy * t);
+
+            SDL_Rect stepRect = {stepX, stepY, w, h};
+            if (!SDL_HasIntersection(&stepRect, node)) continue;
+
+            if (PixelsOverlap(this, stepX, stepY, node)) 
+            {
+                impact = t;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Keep the enemy the laser reaches first along its move
+    void FindHitTarget(GameObject* node, float& firstImpact)
+    {
+        // Loop through the children 
+        for (int i = 0; i < node->children.size(); i++) 
+        {
+            FindHitTarget(node->children[i], firstImpact);
+        }
+
+        // If not an enemy, or one that's already dying, then skip it
+        if (node->type != GameObject::Type::ENEMY || node->GetDestroyQueuedVal()) return;
+
+        float impact;
+        if (!SweptAABB(prevPos, pos, w, h, *node, impact)) return;
+        if (!FirstPixelContact(node, impact)) return;
+
+        if (hitTarget == NULL || impact < firstImpact) 
+        {
+            hitTarget = node;
+            firstImpact = impact;
+        }
+    }
+};
+
+class Alien : public SpriteObject
+{
+    public:
+    Alien(const Vector2Int& inPos = Vector2Int(0, 0),
+          SDL_General* SDL_GenPtr = NULL,
+          Scene* scenePtr = NULL,
+          GameObject* rootPtr = NULL,
+          const char* spriteFile = NULL)
+        : SpriteObject(inPos, SDL_GenPtr, scenePtr, rootPtr, spriteFile)
+    {
+        // Set the game object type
+        type = Type::ENEMY;
+    }
+
+    ObjectPool<Alien>* pool = NULL;
+
+    // The alien's place in the formation, and the path it's flying relative
+    // to that place if it's not sitting in it
+    Vector2Int slot;
+    int path = -1;
+    float pathDistance = 0;
+    int pathOffsetX = 0;    // Bends the middle of the path sideways, a dive's aim
+
+    void OnSpawn() override
+    {
+        slot = Vector2Int(x, y);
+    }
+
+    // Hand the slot back to the alien prefab
+    void Destroy() override
+    {
+        DestroyChildren();
+        pool->Release(this);
+    }
+
+    void Process(const float& deltaTime) override
+    {
+        // Check if the alien is being hit by a projectile
+        if (IsHit(root)) TakeDamage();
+
+        // Check if the alien is dead
+        if (health <= 0) 
+        {
+            // Let the score and kill log know
+            SDL_Gen->gameEvents.Push(GameEvent::Make(GameEvent::ENEMY_KILLED, pointValue, name));
+
+            SDL_Gen->mixer.Play(SoundMixer::ALIEN_KILLED);
+
+            // Queue destruction
+            SetDestroyQueuedVal(true);
+        }
+    }
+
+    bool IsHit(GameObject* node)
+    {
+        // Loop over the projectiles
+        for (int i = 0; i < node->children.size(); i++) {
+            if (IsHit(node->children[i])) return true;
+        }
+
+        // If not projectile then return false
+        if (node->type != GameObject::Type::PROJECTILE) return false;
+
+        // Let the laser check its swept path
+        return ((Laser*) node)->Hits(this);
+    }
+
+    void TakeDamage()
+    {
+        // Tick the health 
+        health -= 1;
+
+        if (health > 0) SDL_Gen->mixer.Play(SoundMixer::ALIEN_HIT);
+    }
+
+    void SaveState(Snapshot& snap) override
+    {
+        snap.Write(x);
+        snap.Write(y);
+        snap.Write(slot);
+        snap.Write(path);
+        snap.Write(pathDistance);
+        snap.Write(pathOffsetX);
+        snap.Write(health);
+        snap.Write(pointValue);
+    }
+
+    void LoadState(Snapshot& snap) override
+    {
+        snap.Read(x);
+        snap.Read(y);
+        snap.Read(slot);
+        snap.Read(path);
+        snap.Read(pathDistance);
+        snap.Read(pathOffsetX);
+        snap.Read(health);
+        snap.Read(pointValue);
+        snap.AddLoadedObject(this);
+    }
+
+    private:
+    int health = 2;
+    int pointValue = 10;
+};
+
+class EnemySpawner : public GameObject
+{
+    public:
+    EnemySpawner(const Vector2Int& inPos = Vector2Int(0, 0),
+                 SDL_General* SDL_GenPtr = NULL,
+                 Scene* scenePtr = NULL,
+                 GameObject* rootPtr = NULL)
+        : GameObject(inPos, SDL_GenPtr, scenePtr, rootPtr),
+          alienPrefab("Alien", SDL_GenPtr, scenePtr, rootPtr, "resources/enemy-01.png")
+    {
+        BuildPaths();
+
+        // Spawn a wave every spawn delay
+        spawnTimer = SDL_Gen->timers.Schedule(
+            spawnDelay,
+            [this]() { SpawnWave(); },
+            spawnDelay);
+
+        // Send an alien out of the formation every dive delay
+        diveTimer = SDL_Gen->timers.Schedule(
+            diveDelay,
+            [this]() { StartDive(); },
+            diveDelay);
+    }
+
+    ~EnemySpawner()
+    {
+        SDL_Gen->timers.Cancel(spawnTimer);
+        SDL_Gen->timers.Cancel(diveTimer);
+
+        // Free the aliens that are still alive
+        DestroyChildren();
+    }
+
+    void SpawnWave()
+    {
+        // Move the current enemies up a level
+        IncrementRowPosOfEnemies(root);
+
+        // Spawn a new enemy in a random col, flying in from its side
+        int col = scene->rng.Range(scene->mainGrid.dim.x);
+        Alien* alien = SpawnAlien(Vector2Int(scene->mainGrid.colPos[col], scene->mainGrid.rowPos[0]));
+        alien->path = col < scene->mainGrid.dim.x / 2 ? ENTRY_LEFT : ENTRY_RIGHT;
+        alien->pathDistance = 0;
+        alien->pathOffsetX = 0;
+        alien->x = alien->slot.x + (int) paths[alien->path].Sample(0).x;
+        alien->y = alien->slot.y + (int) paths[alien->path].Sample(0).y;
+    }
+
+    void StartDive()
+    {
+        // Pick one of the aliens sitting in the formation
+        std::vector<Alien*> waiting;
+        for (int i = 0; i < children.size(); i++) 
+        {
+            Alien* alien = (Alien*) children[i];
+            if (alien->path < 0) waiting.push_back(alien);
+        }
+        if (waiting.empty()) return;
+
+        Alien* alien = waiting[scene->rng.Range((int) waiting.size())];
+        alien->path = DIVE;
+        alien->pathDistance = 0;
+
+        // Aim at where the ship is now, it's a dodge not a homing missile
+        alien->pathOffsetX = 0;
+        if (target != NULL) alien->pathOffsetX = (target->x + target->w / 2) - (alien->slot.x + alien->w / 2);
+    }
+
+    // The object diving aliens aim at
+    void SetTarget(const GameObject* inTarget) { target = inTarget; }
+
+    void Process(const float& deltaTime) override
+    {
+        AdvancePaths(deltaTime);
+    }
+
+    // The aliens win once one steps past the bottom row or rams the ship
+    bool HasReached(const GameObject* ship) const
+    {
+        for (int i = 0; i < children.size(); i++) 
+        {
+            const Alien* alien = (const Alien*) children[i];
+            if (alien->slot.y > scene->mainGrid.rowPos.back()) return true;
+
+            if (SDL_HasIntersection(alien, ship) && PixelsOverlap(alien, alien->x, alien->y, ship)) return true;
+        }
+
+        return false;
+    }
+
+    // Move every alien on a path in one pass, it's only a lookup and a lerp each
+    void AdvancePaths(const float& deltaTime)
+    {
+        for (int i = 0; i < children.size(); i++) 
+        {
+            Alien* alien = (Alien*) children[i];
+            if (alien->path < 0) continue;
+
+            const SplinePath& spline = paths[alien->path];
+            alien->pathDistance += pathSpeeds[alien->path] * deltaTime;
+
+            // Back in the formation
+            if (alien->pathDistance >= spline.length) 
+            {
+                alien->path = -1;
+                alien->x = alien->slot.x;
+                alien->y = alien->slot.y;
+                continue;
+            }
+
+            // The sideways offset fades in and back out so both ends stay on the path
+            Vector2 offset = spline.Sample(alien->pathDistance);
+            offset.x += alien->pathOffsetX * std::sin((float) M_PI * alien->pathDistance / spline.length);
+            alien->x = alien->slot.x + (int) offset.x;
+            alien->y = alien->slot.y + (int) offset.y;
+        }
+    }
+
+    Alien* SpawnAlien(const Vector2Int& inPos)
+    {
+        Alien* alien = alienPrefab.Spawn(inPos);
+        children.push_back(alien);
+        return alien;
+    }
+
+    void SaveState(Snapshot& snap) override
+    {
+        snap.Write(SDL_Gen->timers.Remaining(spawnTimer));
+        snap.Write(SDL_Gen->timers.Remaining(diveTimer));
+
+        snap.Write((int) children.size());
+        for (int i = 0; i < children.size(); i++) children[i]->SaveState(snap);
+    }
+
+    void LoadState(Snapshot& snap) override
+    {
+        // Pick the wave timer back up where it was
+        Uint32 timeLeft;
+        snap.Read(timeLeft);
+        SDL_Gen->timers.Cancel(spawnTimer);
+        spawnTimer = SDL_Gen->timers.Schedule(
+            timeLeft,
+            [this]() { SpawnWave(); },
+            spawnDelay);
+
+        snap.Read(timeLeft);
+        SDL_Gen->timers.Cancel(diveTimer);
+        diveTimer = SDL_Gen->timers.Schedule(
+            timeLeft,
+            [this]() { StartDive(); },
+            diveDelay);
+
+        // Swap the current aliens for the saved ones
+        DestroyChildren();
+
+        int count;
+        snap.Read(count);
+        for (int i = 0; i < count && !snap.Failed(); i++) 
+        {
+            SpawnAlien(Vector2Int())->LoadState(snap);
+        }
+    }
+
+    private:
+    enum PathId
+    {
+        ENTRY_LEFT,
+        ENTRY_RIGHT,
+        DIVE,
+        PATH_COUNT
+    };
+
+    const Uint32 spawnDelay = 2000;
+    const Uint32 diveDelay = 3000;
+    TimerWheel::Handle spawnTimer;
+    TimerWheel::Handle diveTimer;
+    Prefab<Alien> alienPrefab;
+    const GameObject* target = NULL;
+
+    // Offsets from an alien's formation slot, ending back on it
+    SplinePath paths[PATH_COUNT];
+    float pathSpeeds[PATH_COUNT];
+
+    void BuildPaths()
+    {
+        // Swoop in from off the top corner and loop down into the slot
+        std::vector<Vector2> entry;
+        entry.push_back(Vector2(-150, -40));
+        entry.push_back(Vector2(-60, 20));
+        entry.push_back(Vector2(0, 80));
+        entry.push_back(Vector2(40, 60));
+        entry.push_back(Vector2(20, 20));
+        entry.push_back(Vector2(0, 0));
+        paths[ENTRY_LEFT].Build(entry);
+        pathSpeeds[ENTRY_LEFT] = 150;
+
+        for (int i = 0; i < entry.size(); i++) entry[i].x = -entry[i].x;
+        paths[ENTRY_RIGHT].Build(entry);
+        pathSpeeds[ENTRY_RIGHT] = 150;
+
+        // Peel off, dive at the ship and climb back up
+        std::vector<Vector2> dive;
+        dive.push_back(Vector2(0, 0));
+        dive.push_back(Vector2(-20, -15));
+        dive.push_back(Vector2(-40, 30));
+        dive.push_back(Vector2(0, 120));
+        dive.push_back(Vector2(50, 160));
+        dive.push_back(Vector2(70, 100));
+        dive.push_back(Vector2(40, 30));
+        dive.push_back(Vector2(0, 0));
+        paths[DIVE].Build(dive);
+        pathSpeeds[DIVE] = 110;
+    }
+
+    void IncrementRowPosOfEnemies(GameObject* node) 
+    {
+        // Loop through the children
+        for (int i = 0; i < node->children.size(); i++) 
+        {
+            IncrementRowPosOfEnemies(node->children[i]);
+        }
+
+        // If not an enemy then return false
+        if (node->type != GameObject::Type::ENEMY) return;
+
+        // Cast the game object pointer to an alien pointer
+        Alien* alien = (Alien*) node;
+
+        // Move the alien's slot down, it follows straight away unless flying
+        alien->slot.y += scene->mainGrid.elemSize.y;
+        if (alien->path < 0) alien->y = alien->slot.y;
+    }
+};
+
+class Ship : public SpriteObject
+{
+    public:
+    Ship(const Vector2Int& inPos = Vector2Int(0, 0),
+         SDL_General* SDL_GenPtr = NULL,
+         Scene* scenePtr = NULL,
+         GameObject* rootPtr = NULL,
+         const char* spriteFile = NULL)
+        : SpriteObject(inPos, SDL_GenPtr, scenePtr, rootPtr, spriteFile),
+          laserPrefab("laser", SDL_GenPtr, scenePtr, rootPtr, "resources/laser-01.png")
+    {
+        startPos = (float) x;
+        targetPos = startPos;
+
+        timerTimeLeft = timerTotalTime;
+    }
+
+    ~Ship()
+    {
+        // Free the lasers that are still in flight
+        DestroyChildren();
+    }
+
+    void Process(const float& deltaTime) override
+    {
+        // Grid movement
+
+        // Check for the user input
+        SDL_Event event;
+        for (int i = 0; i < SDL_Gen->events.size(); i++) 
+        {
+            event = SDL_Gen->events[i];
+            switch (event.type) {
+                case SDL_KEYDOWN:
+                    switch (event.key.keysym.scancode) {
+                        case SDL_SCANCODE_RIGHT:
+                        case SDL_SCANCODE_D:
+                            UpdateTargetPos(1);
+                            break;
+                        case SDL_SCANCODE_LEFT:
+                        case SDL_SCANCODE_A:
+                            UpdateTargetPos(-1);
+                            break;
+                        case SDL_SCANCODE_SPACE:
+                            ShootLaser();
+                            break;
+                        default:
+                            break;
+                    }
+                    break;
+            }
+        }
+
+        NewTranslateToPos(deltaTime);
+    }
+
+    void UpdateTargetPos(int increment) 
+    {
+        // Check if the target is still translating
+        if (timerTimeLeft < timerTotalTime) return;
+
+        // Check for bounds
+        if (targetIndex + increment < 0) return;
+        if (targetIndex + increment >= (int) scene->mainGrid.colPos.size()) return;
+
+        // Set the target and start positions
+        targetIndex += increment;
+        targetPos = (float) scene->mainGrid.colPos[targetIndex];
+        startPos = (float) x;
 
-        // Move the current enemies up a level
-        IncrementRowPosOfEnemies(root);
+        // Reset the timer clock
+        timerTimeLeft = 0;  // Reset the timer
+
+        // std::cout << "Target Index: " << std::to_string(targetIndex) << std::endl;
+    }
+
+    float easeInOutSine(float x) 
+    {
+        float pi = 3.14;
+        return -(cos(pi * x) - 1) / 2;
+    }
+
+    float easeOutElastic(float x) 
+    {
+        const float pi = 3.14;
+        const double c4 = (2 * M_PI) / 3;
+
+        if (x == 0) {
+            return 0;
+        } else if (x == 1) {
+            return 1;
+        } else {
+            return pow(2, -10 * x) * sin((x * 10 - 0.75) * c4) + 1;
+        }
+    }
+
+    float easeOutBack(float x)
+    {
+        const float c1 = 1.70158;
+        const float c3 = c1 + 1;
+
+        return 1 + c3 * pow(x - 1, 3) + c1 * pow(x - 1, 2);
+    }
+
+    void NewTranslateToPos(float deltaTime)
+    {
+        timerTimeLeft += deltaTime;
+
+        if (timerTimeLeft >= timerTotalTime) return;
+
+        float ease = easeOutBack(timerTimeLeft / timerTotalTime);
+        float newPos = (targetPos - startPos) * ease + startPos;
+
+        // std::cout << "Ease: " << std::to_string(newPos) << std::endl;
+
+        x = (int) newPos;
+    }
+
+    void ShootLaser()
+    {
+        // Spawn a laser bolt
+        SpawnLaser(Vector2Int(x + w / 2, y));
+
+        SDL_Gen->mixer.Play(SoundMixer::LASER_FIRED);
+        SDL_Gen->gameEvents.Push(GameEvent::Make(GameEvent::PROJECTILE_FIRED));
+    }
+
+    Laser* SpawnLaser(const Vector2Int& inPos)
+    {
+        Laser* laser = laserPrefab.Spawn(inPos);
+        children.push_back(laser);
+        return laser;
+    }
+
+    void SaveState(Snapshot& snap) override
+    {
+        snap.Write(x);
+        snap.Write(targetIndex);
+        snap.Write(timerTimeLeft);
+        snap.Write(startPos);
+        snap.Write(targetPos);
+
+        snap.Write((int) children.size());
+        for (int i = 0; i < children.size(); i++) children[i]->SaveState(snap);
+    }
+
+    void LoadState(Snapshot& snap) override
+    {
+        snap.Read(x);
+        snap.Read(targetIndex);
+        snap.Read(timerTimeLeft);
+        snap.Read(startPos);
+        snap.Read(targetPos);
+
+        // Swap the lasers in flight for the saved ones
+        DestroyChildren();
+
+        int count;
+        snap.Read(count);
+        for (int i = 0; i < count && !snap.Failed(); i++) 
+        {
+            SpawnLaser(Vector2Int())->LoadState(snap);
+        }
+    }
+
+    private:
+    int targetIndex = 3;
+    float timerTimeLeft = 0;
+    float timerTotalTime = 0.2;
+    float startPos;
+    float targetPos;
+    Prefab<Laser> laserPrefab;
+};
+
+// -----------------------------------------------------------------------------
+void RenderGameObjects(GameObject* node) 
+{
+    // Dig down the root's children
+    for (int i = 0; i < node->children.size(); i++) 
+    {
+        RenderGameObjects(node->children[i]);
+    }
+
+    // Render the node
+    Texture* tex = node->GetTexture();
+    if (tex == NULL) return;
+
+    node->SDL_Gen->renderer->DrawSprite(
+        tex,
+        *node,
+        node->GetTint());
+}
+
+void ProcessObjectTree(GameObject* node, float delta)
+{
+    // Dig down the root's children
+    for (int i = node->children.size() - 1; i >= 0; i--) 
+    {
+        ProcessObjectTree(node->children[i], delta);
+    }
+
+    // Process the current node
+    node->Process(delta);
+}
+
+// Number the enemies in tree order so pointers to them can be saved
+void AssignSnapshotIds(GameObject* node, int& nextId)
+{
+    for (int i = 0; i < node->children.size(); i++) 
+    {
+        AssignSnapshotIds(node->children[i], nextId);
+    }
+
+    if (node->type == GameObject::Type::ENEMY) node->snapshotId = nextId++;
+}
+
+// Save the simulation state. The root's direct children are fixed for the
+// whole game, each one saves whatever it has spawned along with itself.
+void SaveGameState(GameObject* root, Scene* scene, Snapshot& snap)
+{
+    int nextId = 0;
+    AssignSnapshotIds(root, nextId);
+
+    snap.BeginWrite();
+    snap.Write(scene->rng.state);
+    snap.Write(root->SDL_Gen->timers.GetPendingTime());
+    snap.Write((int) root->children.size());
+    for (int i = 0; i < root->children.size(); i++) root->children[i]->SaveState(snap);
+}
+
+bool LoadGameState(GameObject* root, Scene* scene, Snapshot& snap)
+{
+    snap.BeginRead();
+
+    Uint64 rngState;
+    snap.Read(rngState);
+
+    double pendingTime;
+    snap.Read(pendingTime);
+
+    int childCount;
+    snap.Read(childCount);
+    if (snap.Failed() || childCount != root->children.size()) 
+    {
+        LOG_ERROR("Snapshot doesn't match the scene");
+        return false;
+    }
+
+    scene->rng.state = rngState;
+    root->SDL_Gen->timers.SetPendingTime(pendingTime);
+    for (int i = 0; i < root->children.size(); i++) root->children[i]->LoadState(snap);
+    snap.ResolveRefs();
+
+    if (snap.Failed()) 
+    {
+        LOG_ERROR("Snapshot is truncated");
+        return false;
+    }
+
+    return true;
+}
+
+// Step through the scene tree and destroy any marked objects
+void DestoryQueuedObjects(GameObject* node)
+{
+    // Dig down the node's children
+    for (int i = node->children.size() - 1; i >= 0; i--) 
+    {
+        DestoryQueuedObjects(node->children[i]);
+
+        // Destory the object
+        if (node->children[i]->GetDestroyQueuedVal()) 
+        {
+            node->children[i]->Destroy();
+            node->children.erase(node->children.begin() + i);
+        }
+    }    
+}
+
+class ScreenStack;
+
+// One step of the game's flow: the menu, gameplay or game over. Each screen
+// lists the sprites it draws so they can be decoded before it's shown.
+class Screen
+{
+    public:
+    std::string name;
+    ScreenStack* stack;
+    SDL_General* SDL_Gen;
+
+    Screen(const char* inName, SDL_General* SDL_GenPtr):
+        name(inName),
+        stack(NULL),
+        SDL_Gen(SDL_GenPtr)
+    {}
+
+    virtual ~Screen() {}
+
+    virtual void DeclareAssets(std::vector<std::string>& sprites) const {}
+
+    // Pushed onto the stack, and popped back off it
+    virtual void Enter() {}
+    virtual void Exit() {}
+
+    virtual void HandleEvent(const SDL_Event& event) {}
+    virtual void Update(const float& deltaTime) {}
+    virtual void Render() {}
+
+    // Overlays are drawn over the screen beneath them
+    virtual bool IsOverlay() const { return false; }
+};
+
+// The screens are owned by main and reused, so switching never rebuilds
+// anything. Changes asked for during a frame are applied between frames.
+class ScreenStack
+{
+    public:
+    ScreenStack(SDL_General* SDL_GenPtr):
+        SDL_Gen(SDL_GenPtr)
+    {}
+
+    void Push(Screen* screen) { pending.push_back(Change(PUSH, screen)); }
+    void Pop() { pending.push_back(Change(POP, NULL)); }
+
+    // Empty the stack and show the given screen
+    void Switch(Screen* screen) { pending.push_back(Change(SWITCH, screen)); }
+
+    // Start decoding a screen's sprites while the current one runs
+    void Preload(const Screen* screen)
+    {
+        std::vector<std::string> sprites;
+        screen->DeclareAssets(sprites);
+        SDL_Gen->PreloadSprites(sprites);
+    }
+
+    void ApplyChanges()
+    {
+        // Entering a screen can queue more changes
+        for (int i = 0; i < pending.size(); i++) 
+        {
+            Change change = pending[i];
+
+            if (change.type == POP || change.type == SWITCH) 
+            {
+                while (!screens.empty()) 
+                {
+                    screens.back()->Exit();
+                    screens.pop_back();
+                    if (change.type == POP) break;
+                }
+            }
+
+            if (change.screen != NULL) 
+            {
+                // Anything not preloaded yet is finished off now
+                Preload(change.screen);
+                SDL_Gen->WaitForPreloads();
+
+                change.screen->stack = this;
+                screens.push_back(change.screen);
+                change.screen->Enter();
+            }
+        }
+
+        pending.clear();
+    }
+
+    void HandleEvent(const SDL_Event& event)
+    {
+        if (!screens.empty()) screens.back()->HandleEvent(event);
+    }
+
+    // Only the top screen runs, the ones beneath it are paused
+    void Update(const float& deltaTime)
+    {
+        if (!screens.empty()) screens.back()->Update(deltaTime);
+    }
+
+    void Render()
+    {
+        if (screens.empty()) return;
+
+        // Draw up from the first screen the overlays sit on
+        int first = screens.size() - 1;
+        while (first > 0 && screens[first]->IsOverlay()) first--;
+
+        for (int i = first; i < screens.size(); i++) screens[i]->Render();
+    }
+
+    bool Empty() const { return screens.empty() && pending.empty(); }
+
+    void Clear()
+    {
+        while (!screens.empty()) 
+        {
+            screens.back()->Exit();
+            screens.pop_back();
+        }
+        pending.clear();
+    }
+
+    private:
+    enum ChangeType
+    {
+        PUSH,
+        POP,
+        SWITCH
+    };
+
+    struct Change
+    {
+        ChangeType type;
+        Screen* screen;
+
+        Change(ChangeType inType, Screen* inScreen):
+            type(inType),
+            screen(inScreen)
+        {}
+    };
+
+    SDL_General* SDL_Gen;
+    std::vector<Screen*> screens;
+    std::vector<Change> pending;
+};
+
+// Adds a line of text to a screen's tree, centered on the given point
+TextObject* AddCenteredText(GameObject* root, Scene* scene, const Vector2Int& inPos, const std::string& text)
+{
+    TextObject* textObject = new TextObject(
+        inPos,
+        root->SDL_Gen,
+        scene,
+        root,
+        text.c_str(),
+        scene->fontFile,
+        scene->fontSize,
+        ColorPalette::TEXT,
+        TextObject::HorzAlign::CENTER);
+    textObject->name = "Screen-Text";
+    root->children.push_back(textObject);
+    return textObject;
+}
+
+class GameplayScreen : public Screen
+{
+    public:
+    Screen* menu;
+    Screen* gameOver;
+
+    GameplayScreen(SDL_General* SDL_GenPtr, HighScoreStore* inHighScores):
+        Screen("Gameplay", SDL_GenPtr),
+        menu(NULL),
+        gameOver(NULL),
+        root(Vector2Int(0, 0), SDL_GenPtr, &scene, NULL),
+        ship(NULL),
+        spawner(NULL),
+        scoreValue(NULL),
+        killLog(NULL),
+        highScores(inHighScores),
+        built(false)
+    {
+        root.name = "Root";
+    }
+
+    ~GameplayScreen()
+    {
+        if (!built) return;
+
+        SDL_Gen->gameEvents.Unsubscribe(scoreValue);
+        SDL_Gen->gameEvents.Unsubscribe(killLog);
+        root.DestroyChildren();
+    }
+
+    void DeclareAssets(std::vector<std::string>& sprites) const override
+    {
+        sprites.push_back("resources/main-game-bckg.png");
+        sprites.push_back("resources/ship-01.png");
+        sprites.push_back("resources/enemy-01.png");
+        sprites.push_back("resources/laser-01.png");
+        sprites.push_back("resources/active-item-slot.png");
+    }
+
+    void Enter() override
+    {
+        NewGame();
+        stack->Preload(gameOver);
+    }
+
+    // The objects are built the first time, after that a new game is just
+    // loading the starting snapshot
+    void NewGame()
+    {
+        if (!built) Build();
+        else Restart();
+    }
+
+    // Play a different game from the same start
+    void Reseed(Uint64 seed)
+    {
+        scene.rng = Random(seed);
+    }
+
+    void Restart()
+    {
+        LoadGameState(&root, &scene, startState);
+    }
+
+    int GetScore() const { return scoreValue->value; }
+    const Scene& GetScene() const { return scene; }
+    const Ship* GetShip() const { return ship; }
+    const EnemySpawner* GetSpawner() const { return spawner; }
+
+    void HandleEvent(const SDL_Event& event) override
+    {
+        if (event.type != SDL_KEYDOWN) return;
+
+        // Save states and restart
+        switch (event.key.keysym.scancode) {
+            case SDL_SCANCODE_F5:
+                SaveGameState(&root, &scene, saveState);
+                break;
+            case SDL_SCANCODE_F9:
+                if (!saveState.data.empty()) LoadGameState(&root, &scene, saveState);
+                break;
+            case SDL_SCANCODE_R:
+                Restart();
+                break;
+            case SDL_SCANCODE_ESCAPE:
+                stack->Switch(menu);
+                break;
+            default:
+                break;
+        }
+    }
+
+    void Update(const float& deltaTime) override
+    {
+        // Log the final score, written out on the high score thread
+        if (Step(deltaTime)) 
+        {
+            highScores->Submit(GetScore());
+            stack->Push(gameOver);
+        }
+    }
+
+    // Run one frame of the simulation, true once the game is lost
+    bool Step(const float& deltaTime)
+    {
+        // Fire any timed events that are due
+        SDL_Gen->timers.Advance(deltaTime);
+
+        // Process our game objects events
+        ProcessObjectTree(&root, deltaTime);
+
+        // Hand this frame's gameplay events to the score and kill log
+        SDL_Gen->gameEvents.Dispatch();
+
+        // Destroy the queued objects
+        DestoryQueuedObjects(&root);
 
-        // Spawn a new enemy in a random col
-        int col = 0 + ( std::rand() % ( scene->mainGrid.dim.x - 0) );
-        Alien* alien = new Alien(
-            Vector2Int(scene->mainGrid.colPos[col], scene->mainGrid.rowPos[0]),
-            SDL_Gen,
-            scene,
-            root,
-            "resources/enemy-01.png");
-        alien->name = "Alien";
-        alien->w *= 3;
-        alien->h *= 3;
-        children.push_back(alien);
+        return spawner->HasReached(ship);
+    }
 
-        elapsedTime = 0;
+    void Render() override
+    {
+        RenderGameObjects(&root);
     }
 
     private:
-    const float spawnDelay = 2.0;
-    float elapsedTime = 0;
-
-    void IncrementRowPosOfEnemies(GameObject* node) 
-    {
-        // Loop through the children
-        for (int i = 0; i < node->children.size(); i++) 
-        {
-            IncrementRowPosOfEnemies(node->children[i]);
-        }
+    Scene scene;
+    GameObject root;
+    Ship* ship;
+    EnemySpawner* spawner;
+    ScoreText* scoreValue;
+    KillLog* killLog;
+    HighScoreStore* highScores;
+    bool built;
 
-        // If not an enemy then return false
-        if (node->type != GameObject::Type::ENEMY) return;
+    // Keep the starting state for instant restarts
+    Snapshot startState;
+    Snapshot saveState;
 
-        // Update the alien's world pos in accordance with cord
-        node->y += scene->mainGrid.elemSize.y;
+    void Build()
+    {
+        // Create the Background object
+        SpriteObject* background = new SpriteObject(
+            Vector2Int(0, 0),
+            SDL_Gen,
+            &scene,
+            &root,
+            "resources/main-game-bckg.png");
+        background->name = "Background";
+        // Authored at window resolution, fit it to the native frame
+        background->w = SDL_Gen->nativeWidth;
+        background->h = SDL_Gen->nativeHeight;
+        root.children.push_back(background);
+
+        // Create the ship object
+        ship = new Ship(
+            Vector2Int(scene.mainGrid.colPos[3], 198),
+            SDL_Gen,
+            &scene,
+            &root,
+            "resources/ship-01.png");
+        ship->name = "Ship";
+        root.children.push_back(ship);
+
+        // Create the enemy spawner
+        spawner = new EnemySpawner(
+            Vector2Int(0, 0),
+            SDL_Gen,
+            &scene,
+            &root);
+        spawner->name = "Enemy-Spawner";
+        spawner->SetTarget(ship);
+        root.children.push_back(spawner);
+
+        // Use the palette's text color for the font
+        ColorPalette::TextColor color = ColorPalette::TEXT;
+
+        // Create the score text
+        const char* fontFile = scene.fontFile;
+        const int fontSize = scene.fontSize;
+        TextObject* scoreText = new TextObject(
+            Vector2Int(250, 168),
+            SDL_Gen,
+            &scene,
+            &root,
+            "Score:",
+            fontFile,
+            fontSize,
+            color);
+        scoreText->name = "Score-Text";
+        root.children.push_back(scoreText);
 
-        // Cast the game object pointer to an alien pointer
-        Alien* alien = (Alien*) node;
+        // Create the score value
+        scoreValue = new ScoreText(
+            Vector2Int(315, 168),
+            SDL_Gen,
+            &scene,
+            &root,
+            "999",
+            fontFile,
+            fontSize,
+            color,
+            TextObject::HorzAlign::RIGHT);
+        scoreValue->name = "Score-Value";
+        root.children.push_back(scoreValue);
+        scoreValue->UpdateValue(0);
+        SDL_Gen->gameEvents.Subscribe(scoreValue);
+
+        // Create the kill log
+        killLog = new KillLog(
+            Vector2Int(0, 0),
+            SDL_Gen,
+            &scene,
+            &root);
+        killLog->name = "Kill-Log";
+        root.children.push_back(killLog);
+        SDL_Gen->gameEvents.Subscribe(killLog);
+
+        // Create the active item text
+        TextObject* activeItemText = new TextObject(
+            Vector2Int(261, 185),
+            SDL_Gen,
+            &scene,
+            &root,
+            "Active Item",
+            fontFile,
+            fontSize,
+            color);
+        activeItemText->name = "Active-Item-Text";
+        root.children.push_back(activeItemText);
 
-        // Check if they should be taking damage in it's new position
-        if (alien->IsHit(root)) alien->TakeDamage();
+        // Create the active tiem slot
+        SpriteObject* activeItemSlot = new SpriteObject(
+            Vector2Int(268, 199),
+            SDL_Gen,
+            &scene,
+            &root,
+            "resources/active-item-slot.png");
+        activeItemSlot->name = "Active-Item-Slot";
+        // Also authored at window resolution
+        activeItemSlot->w /= SDL_Gen->pixelScale;
+        activeItemSlot->h /= SDL_Gen->pixelScale;
+        root.children.push_back(activeItemSlot);
+
+        SaveGameState(&root, &scene, startState);
+        built = true;
     }
 };
 
-class Ship : public SpriteObject
+class MenuScreen : public Screen
 {
     public:
-    Ship(const Vector2Int& inPos = Vector2Int(0, 0),
-         SDL_General* SDL_GenPtr = NULL,
-         Scene* scenePtr = NULL,
-         GameObject* rootPtr = NULL,
-         const char* spriteFile = NULL)
-        : SpriteObject(inPos, SDL_GenPtr, scenePtr, rootPtr, spriteFile)
+    Screen* gameplay;
+
+    MenuScreen(SDL_General* SDL_GenPtr, HighScoreStore* inHighScores):
+        Screen("Menu", SDL_GenPtr),
+        gameplay(NULL),
+        root(Vector2Int(0, 0), SDL_GenPtr, &scene, NULL),
+        highScores(inHighScores)
     {
-        float startPos = (float) x;
-        float targetPos = startPos;
+        root.name = "Menu-Root";
+    }
 
-        timerTimeLeft = timerTotalTime;
+    ~MenuScreen()
+    {
+        root.DestroyChildren();
     }
 
-    void Process(const float& deltaTime) override
+    void DeclareAssets(std::vector<std::string>& sprites) const override
     {
-        // Grid movement
+        sprites.push_back("resources/main-game-bckg.png");
+    }
 
-        // Check for the user input
-        SDL_Event event;
-        for (int i = 0; i < SDL_Gen->events.size(); i++) 
+    void Enter() override
+    {
+        SpriteObject* background = new SpriteObject(
+            Vector2Int(0, 0),
+            SDL_Gen,
+            &scene,
+            &root,
+            "resources/main-game-bckg.png");
+        background->name = "Background";
+        background->w = SDL_Gen->nativeWidth;
+        background->h = SDL_Gen->nativeHeight;
+        root.children.push_back(background);
+
+        int centerX = SDL_Gen->nativeWidth / 2;
+        AddCenteredText(&root, &scene, Vector2Int(centerX, 40), "GAME ZERO");
+        AddCenteredText(&root, &scene, Vector2Int(centerX, 60), "Press Enter to start");
+
+        // The scores are read fresh every time the menu comes back up
+        AddCenteredText(&root, &scene, Vector2Int(centerX, 100), "High Scores");
+        for (int i = 0; i < highScores->GetCount() && i < 5; i++) 
         {
-            event = SDL_Gen->events[i];
-            switch (event.type) {
-                case SDL_KEYDOWN:
-                    switch (event.key.keysym.scancode) {
-                        case SDL_SCANCODE_RIGHT:
-                        case SDL_SCANCODE_D:
-                            UpdateTargetPos(1);
-                            break;
-                        case SDL_SCANCODE_LEFT:
-                        case SDL_SCANCODE_A:
-                            UpdateTargetPos(-1);
-                            break;
-                        case SDL_SCANCODE_SPACE:
-                            ShootLaser();
-                            break;
-                        default:
-                            break;
-                    }
-                    break;
-            }
+            AddCenteredText(
+                &root, 
+                &scene, 
+                Vector2Int(centerX, 116 + i * 14), 
+                to_string(i + 1) + ".  " + to_string(highScores->GetEntry(i).score));
         }
 
-        NewTranslateToPos(deltaTime);
+        // Get the game's sprites ready while the player reads the menu
+        stack->Preload(gameplay);
     }
 
-    void UpdateTargetPos(int increment) 
+    void Exit() override
     {
-        // Check if the target is still translating
-        if (timerTimeLeft < timerTotalTime) return;
+        root.DestroyChildren();
+    }
 
-        // Check for bounds
-        if (targetIndex + increment < 0) return;
-        if (targetIndex + increment >= (int) scene->mainGrid.colPos.size()) return;
+    void HandleEvent(const SDL_Event& event) override
+    {
+        if (event.type != SDL_KEYDOWN) return;
 
-        // Set the target and start positions
-        targetIndex += increment;
-        targetPos = (float) scene->mainGrid.colPos[targetIndex];
-        startPos = (float) x;
+        switch (event.key.keysym.scancode) {
+            case SDL_SCANCODE_RETURN:
+                stack->Switch(gameplay);
+                break;
+            case SDL_SCANCODE_ESCAPE:
+                stack->Pop();
+                break;
+            default:
+                break;
+        }
+    }
 
-        // Reset the timer clock
-        timerTimeLeft = 0;  // Reset the timer
+    void Render() override
+    {
+        RenderGameObjects(&root);
+    }
 
-        // std::cout << "Target Index: " << std::to_string(targetIndex) << std::endl;
+    private:
+    Scene scene;
+    GameObject root;
+    HighScoreStore* highScores;
+};
+
+// Shown over the last frame of the game that just ended
+class GameOverScreen : public Screen
+{
+    public:
+    Screen* menu;
+    GameplayScreen* gameplay;
+
+    GameOverScreen(SDL_General* SDL_GenPtr, HighScoreStore* inHighScores):
+        Screen("Game-Over", SDL_GenPtr),
+        menu(NULL),
+        gameplay(NULL),
+        root(Vector2Int(0, 0), SDL_GenPtr, &scene, NULL),
+        highScores(inHighScores)
+    {
+        root.name = "Game-Over-Root";
     }
 
-    float easeInOutSine(float x) 
+    ~GameOverScreen()
     {
-        float pi = 3.14;
-        return -(cos(pi * x) - 1) / 2;
+        root.DestroyChildren();
     }
 
-    float easeOutElastic(float x) 
+    bool IsOverlay() const override { return true; }
+
+    void Enter() override
     {
-        const float pi = 3.14;
-        const double c4 = (2 * M_PI) / 3;
+        // Centered on the play field, clear of the side panel
+        int centerX = scene.mainFrame.origin.x + scene.mainFrame.size.x / 2;
+        AddCenteredText(&root, &scene, Vector2Int(centerX, 80), "GAME OVER");
+        AddCenteredText(&root, &scene, Vector2Int(centerX, 100), "Score  " + to_string(gameplay->GetScore()));
+        AddCenteredText(&root, &scene, Vector2Int(centerX, 114), "Best  " + to_string(highScores->GetBest()));
+        AddCenteredText(&root, &scene, Vector2Int(centerX, 140), "Enter to play again");
+        AddCenteredText(&root, &scene, Vector2Int(centerX, 154), "Esc for the menu");
+    }
 
-        if (x == 0) {
-            return 0;
-        } else if (x == 1) {
-            return 1;
-        } else {
-            return pow(2, -10 * x) * sin((x * 10 - 0.75) * c4) + 1;
-        }
+    void Exit() override
+    {
+        root.DestroyChildren();
     }
 
-    float easeOutBack(float x)
+    void HandleEvent(const SDL_Event& event) override
     {
-        const float c1 = 1.70158;
-        const float c3 = c1 + 1;
+        if (event.type != SDL_KEYDOWN) return;
 
-        return 1 + c3 * pow(x - 1, 3) + c1 * pow(x - 1, 2);
+        switch (event.key.keysym.scancode) {
+            case SDL_SCANCODE_RETURN:
+                stack->Switch(gameplay);
+                break;
+            case SDL_SCANCODE_ESCAPE:
+                stack->Switch(menu);
+                break;
+            default:
+                break;
+        }
     }
 
-    void NewTranslateToPos(float deltaTime)
+    void Render() override
     {
-        timerTimeLeft += deltaTime;
+        RenderGameObjects(&root);
+    }
 
-        if (timerTimeLeft >= timerTotalTime) return;
+    private:
+    Scene scene;
+    GameObject root;
+    HighScoreStore* highScores;
+};
 
-        float ease = easeOutBack(timerTimeLeft / timerTotalTime);
-        float newPos = (targetPos - startPos) * ease + startPos;
+// Scripted player for headless runs. Chases the alien closest to the bottom
+// and shoots when under it, pressing keys the same way a player would.
+class BotPlayer
+{
+    public:
+    BotPlayer(Uint64 seed = 1):
+        rng(seed),
+        fireCooldown(0)
+    {}
 
-        // std::cout << "Ease: " << std::to_string(newPos) << std::endl;
+    void Think(const GameplayScreen& gameplay, std::vector<SDL_Event>& events, const float& deltaTime)
+    {
+        const Ship* ship = gameplay.GetShip();
+        const EnemySpawner* spawner = gameplay.GetSpawner();
+        const Grid& grid = gameplay.GetScene().mainGrid;
 
-        x = (int) newPos;
-    }
+        fireCooldown -= deltaTime;
 
-    void ShootLaser()
-    {
-        // Spawn a laser bolt
-        Laser* laser = new Laser(
-            Vector2Int(x + w / 2, y),
-            SDL_Gen,
-            scene,
-            root,
-            "resources/laser-01.png");
-        laser->name = "laser";
-        laser->w *= 3;
-        laser->h *= 3;
-        children.push_back(laser);
+        // Find the lowest alien
+        const GameObject* target = NULL;
+        for (int i = 0; i < spawner->children.size(); i++) 
+        {
+            const GameObject* alien = spawner->children[i];
+            if (target == NULL || alien->y > target->y) target = alien;
+        }
+        if (target == NULL) return;
+
+        // Step towards its column, then fire with a little human-ish jitter
+        int offset = target->x - ship->x;
+        if (offset > grid.elemSize.x / 2) PressKey(events, SDL_SCANCODE_RIGHT);
+        else if (offset < -grid.elemSize.x / 2) PressKey(events, SDL_SCANCODE_LEFT);
+        else if (fireCooldown <= 0) 
+        {
+            PressKey(events, SDL_SCANCODE_SPACE);
+            fireCooldown = 0.15f + rng.Range(100) / 1000.0f;
+        }
     }
 
     private:
-    int targetIndex = 3;
-    float timerTimeLeft = 0;
-    float timerTotalTime = 0.2;
-    float startPos;
-    float targetPos;
+    Random rng;
+    float fireCooldown;
+
+    static void PressKey(std::vector<SDL_Event>& events, SDL_Scancode scancode)
+    {
+        SDL_Event event;
+        std::memset(&event, 0, sizeof(event));
+        event.type = SDL_KEYDOWN;
+        event.key.keysym.scancode = scancode;
+        events.push_back(event);
+    }
 };
 
-// -----------------------------------------------------------------------------
-void RenderGameObjects(GameObject* node) 
+// Plays a batch of headless games across a pool of threads to soak test
+// balance and engine changes. Each worker owns its own engine and gameplay,
+// and takes games off a shared counter, starting each from the snapshot.
+class BatchRunner
 {
-    // Dig down the root's children
-    for (int i = 0; i < node->children.size(); i++) 
+    public:
+    struct GameResult
     {
-        RenderGameObjects(node->children[i]);
-    }
+        int score;
+        int frames;
+    };
 
-    // Render the node
-    SDL_RenderCopy(
-        node->SDL_Gen->rend, 
-        node->tex, 
-        NULL,
-        node);
-}
+    BatchRunner(int inGameCount, int inThreadCount, Uint64 inSeed, int inMaxFrames = 60 * 60 * 5):
+        gameCount(inGameCount),
+        threadCount(inThreadCount),
+        seed(inSeed),
+        maxFrames(inMaxFrames),
+        nextGame(0),
+        seconds(0)
+    {}
 
-void ProcessObjectTree(GameObject* node, float delta)
-{
-    // Dig down the root's children
-    for (int i = node->children.size() - 1; i >= 0; i--) 
+    void Run()
     {
-        ProcessObjectTree(node->children[i], delta);
+        results.assign(gameCount, GameResult());
+        nextGame.store(0);
+
+        // Load the image decoders up front, first use isn't thread safe
+        IMG_Init(IMG_INIT_PNG);
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        std::vector<std::thread> workers;
+        for (int i = 0; i < threadCount; i++) workers.push_back(std::thread(&BatchRunner::WorkerLoop, this));
+        for (int i = 0; i < threadCount; i++) workers[i].join();
+
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
     }
 
-    // Process the current node
-    node->Process(delta);
-}
+    void PrintReport() const
+    {
+        long long totalFrames = 0;
+        long long totalScore = 0;
+        int bestScore = 0;
+        int timedOut = 0;
+        for (int i = 0; i < gameCount; i++) 
+        {
+            totalFrames += results[i].frames;
+            totalScore += results[i].score;
+            bestScore = std::max(bestScore, results[i].score);
+            if (results[i].frames >= maxFrames) timedOut++;
+        }
 
-// Step through the scene tree and destroy any marked objects
-void DestoryQueuedObjects(GameObject* node)
-{
-    // Dig down the node's children
-    for (int i = node->children.size() - 1; i >= 0; i--) 
+        double games = std::max(gameCount, 1);
+        double wallSeconds = std::max(seconds, 1e-6);
+
+        std::cout << "Batch: " << gameCount << " games on " << threadCount << " threads in " 
+                  << wallSeconds << " s" << std::endl;
+        std::cout << "Throughput: " << totalFrames / wallSeconds << " frames/s, " 
+                  << gameCount / wallSeconds << " games/s, " 
+                  << totalFrames / 60.0 / wallSeconds << "x real time" << std::endl;
+        std::cout << "Score: mean " << totalScore / games << ", best " << bestScore 
+                  << ", mean game length " << totalFrames / 60.0 / games << " s" 
+                  << ", " << timedOut << " hit the " << maxFrames / 60 << " s limit" << std::endl;
+    }
+
+    private:
+    int gameCount;
+    int threadCount;
+    Uint64 seed;
+    int maxFrames;
+    std::atomic<int> nextGame;
+    std::vector<GameResult> results;
+    double seconds;
+
+    void WorkerLoop()
     {
-        DestoryQueuedObjects(node->children[i]);
+        const float deltaTime = 1 / 60.0f;
 
-        // Destory the object
-        if (node->children[i]->GetDestroyQueuedVal()) 
+        SDL_General engine;
+        engine.InitHeadless();
+
+        // Scoped so the objects are gone before the engine shuts down
         {
-            node->children[i]->Destroy();
-            node->children.erase(node->children.begin() + i);
+            GameplayScreen gameplay(&engine, NULL);
+
+            while (true) 
+            {
+                int game = nextGame.fetch_add(1);
+                if (game >= gameCount) break;
+
+                // Every game gets its own seed, so a batch is reproducible
+                gameplay.NewGame();
+                gameplay.Reseed(seed + game);
+                BotPlayer bot(seed + game);
+
+                int frames = 0;
+                while (frames < maxFrames) 
+                {
+                    engine.events.clear();
+                    bot.Think(gameplay, engine.events, deltaTime);
+
+                    frames++;
+                    if (gameplay.Step(deltaTime)) break;
+                }
+
+                results[game].score = gameplay.GetScore();
+                results[game].frames = frames;
+            }
         }
-    }    
-}
+
+        engine.Quit();
+    }
+};
 
 // -----------------------------------------------------------------------------
 // MAIN
-int main() 
+int main(int argc, char* argv[]) 
 {
-    // Set the game loop frame rate
-    const int frameRate = 60;
-    const float frameRateF = (float) frameRate;
+    // Set the game loop frame pacing
+    //   --vsync (default), --fps=N to cap at N fps, --uncapped
+    // and --software to draw with the CPU rasterizer, --log=FILE to log to a file.
+    // --batch=N plays N headless bot games instead, on --threads=N with --seed=N.
+    // --threads is capped so every worker and the main thread get a log ring.
+    FramePacer::Mode pacingMode = FramePacer::VSYNC;
+    int frameRate = 60;
+    bool useSoftwareRenderer = false;
+    std::string logFile;
+    int batchGames = 0;
+    int batchThreads = std::max(1, (int) std::thread::hardware_concurrency());
+    Uint64 batchSeed = 1;
+    for (int i = 1; i < argc; i++) 
+    {
+        std::string arg = argv[i];
+        if (arg == "--software") useSoftwareRenderer = true;
+        else if (arg == "--vsync") pacingMode = FramePacer::VSYNC;
+        else if (arg == "--uncapped") pacingMode = FramePacer::UNCAPPED;
+        else if (arg.compare(0, 6, "--log=") == 0) logFile = arg.substr(6);
+        else if (arg.compare(0, 8, "--batch=") == 0) batchGames = std::max(0, std::atoi(arg.c_str() + 8));
+        else if (arg.compare(0, 10, "--threads=") == 0) batchThreads = std::max(1, std::atoi(arg.c_str() + 10));
+        else if (arg.compare(0, 7, "--seed=") == 0) batchSeed = std::strtoull(arg.c_str() + 7, NULL, 10);
+        else if (arg.compare(0, 6, "--fps=") == 0) 
+        {
+            pacingMode = FramePacer::CAPPED;
+            frameRate = std::max(1, std::atoi(arg.c_str() + 6));
+        }
+    }
+
+    // The window surface never waits for vsync, so the software renderer caps instead
+    if (useSoftwareRenderer && pacingMode == FramePacer::VSYNC) pacingMode = FramePacer::CAPPED;
+    FramePacer pacer(pacingMode, frameRate);
+
+    // Diagnostics are written out on the logger's own thread
+    Logger::Get().Init(logFile.empty() ? NULL : logFile.c_str());
+
+    // Soak test without opening a window
+    if (batchGames > 0) 
+    {
+        batchThreads = std::min(batchThreads, Logger::maxThreads - 1);
+        BatchRunner batch(batchGames, batchThreads, batchSeed);
+        batch.Run();
+        batch.PrintReport();
+
+        Logger::Get().Quit();
+        return 0;
+    }
 
     // Init the SDL enviroment
     SDL_General SDL_Gen;
@@ -929,156 +5358,144 @@ int main()
     // Create the game Window
     SDL_Gen.CreateWindow(
         "Hello SDL!",
-        0);
+        SDL_WINDOW_RESIZABLE);
+
+    // Vsync follows the monitor, not --fps. Some drivers report 0 for the rate
+    SDL_DisplayMode displayMode;
+    if (SDL_GetWindowDisplayMode(SDL_Gen.window, &displayMode) == 0) pacer.SetRefreshRate(displayMode.refresh_rate);
 
     // Create the renderer for the game window
-    SDL_Gen.CreateRenderer(SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-
-    // Create the Scene Object
-    Scene scene = Scene();
-
-    // Create the scene tree list
-    GameObject root = GameObject(
-        Vector2Int(0, 0),
-        &SDL_Gen,
-        &scene,
-        NULL);
-    root.name = "Root";
-
-    // Create the Background object
-    GameObject background = SpriteObject(
-        Vector2Int(0, 0),
-        &SDL_Gen,
-        &scene,
-        &root,
-        "resources/main-game-bckg.png");
-    background.name = "Background";
-    root.children.push_back(&background);
-
-    // Create the ship object
-    Ship ship = Ship(
-        Vector2Int(scene.mainGrid.colPos[3], 595),
-        &SDL_Gen,
-        &scene,
-        &root,
-        "resources/ship-01.png");
-    ship.name = "Ship";
-    ship.w *= 3;
-    ship.h *= 3;
-    root.children.push_back(&ship);
-
-    // Create the enemy spawner
-    EnemySpawner spawner = EnemySpawner(
-        Vector2Int(0, 0),
-        &SDL_Gen,
-        &scene,
-        &root);
-    spawner.name = "Enemy-Spawner";
-    root.children.push_back(&spawner);
-
-    // Create the color for the font
-    SDL_Color color = {255, 255, 255, 255};
-
-    // Create the score text
-    const char* fontFile = "resources/Born2bSportyV2.ttf";
-    TextObject scoreText = TextObject(
-        Vector2Int(751, 505),
-        &SDL_Gen,
-        &scene,
-        &root,
-        "Score:",
-        fontFile,
-        32,
-        color);
-    scoreText.name = "Score-Text";
-    root.children.push_back(&scoreText);
-
-    // Create the score value
-    ScoreText scoreValue = ScoreText(
-        Vector2Int(945, 505),
-        &SDL_Gen,
-        &scene,
-        &root,
-        "999",
-        fontFile,
-        32,
-        color,
-        TextObject::HorzAlign::RIGHT);
-    scoreValue.name = "Score-Value";
-    root.children.push_back(&scoreValue);
-    scoreValue.UpdateValue(0);
-
-    // Create the active item text
-    TextObject activeItemText = TextObject(
-        Vector2Int(783, 555),
-        &SDL_Gen,
-        &scene,
-        &root,
-        "Active Item",
-        fontFile,
-        32,
-        color);
-    activeItemText.name = "Active-Item-Text";
-    root.children.push_back(&activeItemText);
-
-    // Create the active tiem slot
-    SpriteObject activeItemSlot = SpriteObject(
-        Vector2Int(803, 598),
-        &SDL_Gen,
-        &scene,
-        &root,
-        "resources/active-item-slot.png");
-    activeItemSlot.name = "Active-Item-Slot";
-    root.children.push_back(&activeItemSlot);
-    
-    // Set to 1 when close window button pressed
-    int closeRequested = 0;
+    Uint32 renderFlags = SDL_RENDERER_ACCELERATED;
+    if (pacer.UsesVsync()) renderFlags |= SDL_RENDERER_PRESENTVSYNC;
+    SDL_Gen.CreateRenderer(renderFlags, useSoftwareRenderer);
 
-    // Main Loop
-    while (!closeRequested) 
+    // Decode the sound effects up front
+    SDL_Gen.mixer.LoadSample(SoundMixer::LASER_FIRED, "resources/laser-01.wav");
+    SDL_Gen.mixer.LoadSample(SoundMixer::ALIEN_HIT, "resources/alien-hit-01.wav");
+    SDL_Gen.mixer.LoadSample(SoundMixer::ALIEN_KILLED, "resources/alien-killed-01.wav");
+
+    // Load the saved high scores
+    HighScoreStore highScores;
+    highScores.Init("highscores.dat");
+
+    for (int i = 0; i < highScores.GetCount(); i++) 
     {
-        float deltaTime = 1 / frameRateF;
+        std::cout << "High Score " << i + 1 << ": " 
+                  << highScores.GetEntry(i).score 
+                  << std::endl;
+    }
 
-        // Process Events
-        SDL_Event event;
-        SDL_Gen.events.clear();
-        while (SDL_PollEvent(&event)) {
-            // Append the events list
-            SDL_Gen.events.push_back(event);
+    // Screenshots (F12) and recordings (F10) are written on their own thread
+    FrameCapture capture;
+    capture.Init(SDL_Gen.nativeWidth, SDL_Gen.nativeHeight);
 
-            switch (event.type) {
-                case SDL_QUIT:
-                    closeRequested = 1;
+    // Scope the screens so their objects are freed before SDL shuts down
+    {
+        ScreenStack screens(&SDL_Gen);
+        MenuScreen menu(&SDL_Gen, &highScores);
+        GameplayScreen gameplay(&SDL_Gen, &highScores);
+        GameOverScreen gameOver(&SDL_Gen, &highScores);
+
+        menu.gameplay = &gameplay;
+        gameplay.menu = &menu;
+        gameplay.gameOver = &gameOver;
+        gameOver.menu = &menu;
+        gameOver.gameplay = &gameplay;
+
+        // Start on the menu
+        screens.Push(&menu);
+        screens.ApplyChanges();
+
+        // The first frame steps by the target frame time
+        float deltaTime = 1 / (float) frameRate;
+        pacer.Start();
+
+        // Main Loop, until the window closes or the last screen is popped
+        while (!screens.Empty()) 
+        {
+            // Process Events
+            SDL_Event event;
+            SDL_Gen.events.clear();
+            while (SDL_PollEvent(&event)) {
+                // Append the events list
+                SDL_Gen.events.push_back(event);
+
+                if (event.type == SDL_QUIT) 
+                {
+                    screens.Clear();
                     break;
+                }
+
+                if (event.type == SDL_KEYDOWN) 
+                {
+                    // Number keys pick the color palette
+                    if (event.key.keysym.scancode >= SDL_SCANCODE_1 &&
+                        event.key.keysym.scancode < SDL_SCANCODE_1 + paletteCount) 
+                    {
+                        SDL_Gen.SetPalette(event.key.keysym.scancode - SDL_SCANCODE_1);
+                    }
+
+                    switch (event.key.keysym.scancode) {
+                        // Screenshot and recording
+                        case SDL_SCANCODE_F12:
+                            capture.RequestScreenshot();
+                            break;
+                        case SDL_SCANCODE_F10:
+                            capture.ToggleRecording();
+                            break;
+                        // Dump the resource counts
+                        case SDL_SCANCODE_F3:
+                            SDL_Gen.resources.PrintStats();
+                            pacer.PrintStats();
+                            capture.PrintStats();
+                            break;
+                        default:
+                            break;
+                    }
+                }
+
+                screens.HandleEvent(event);
             }
-        }
+            if (screens.Empty()) break;
 
-        // Process our game objects events
-        ProcessObjectTree(&root, deltaTime);
+            // Turn a couple of background decoded sprites into textures
+            SDL_Gen.FinishPreloads(2);
 
-        // Destroy the queued objects
-        DestoryQueuedObjects(&root);
+            // Run the top screen
+            screens.Update(deltaTime);
 
-        // Clear the window by setting it black
-        SDL_RenderClear(SDL_Gen.rend);
+            // Clear the native resolution frame by setting it black
+            SDL_Gen.BeginFrame();
 
-        // Draw the ship to the render window
-        RenderGameObjects(&root);
-        // SDL_RenderCopy(
-        //     SDL_Gen.rend, 
-        //     tex, 
-        //     &srcRect, 
-        //     &dstRect);
+            // Draw the screens to the render window
+            screens.Render();
 
-        // Swaps the render from the back buffer to the front
-        SDL_RenderPresent(SDL_Gen.rend);
+            // Hand the frame to the capture thread if recording
+            capture.Capture(SDL_Gen.renderer);
+
+            // Upscale the frame to the window and present it
+            SDL_Gen.PresentFrame();
+
+            // Switch screens between frames
+            screens.ApplyChanges();
+
+            // Wait out the frame and measure how long it took
+            deltaTime = pacer.EndFrame();
+        }
+
+        pacer.PrintStats();
 
-        // Wait frame delay
-        SDL_Delay(1000 / frameRateF);
+        screens.Clear();
     }
 
+    highScores.Quit();
+    capture.Quit();
+
     SDL_Gen.Quit();
 
+    // Flush whatever is still queued, including the leak report
+    Logger::Get().Quit();
+
     return 0;
 }
 // -----------------------------------------------------------------------------
\ No newline at end of file